@@ -0,0 +1,337 @@
+#include "planet.h"
+#include "solarsystem.h"
+#include "simulation.h"
+#include "ui.h"
+#include "bvh.h"
+#include "global.h"
+
+#include <glm/glm.hpp>
+#include <stb_image/stb_image.h>
+
+#include <vector>
+#include <string>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <functional>
+#include <algorithm>
+#include <random>
+#include <filesystem>
+#include <cmath>
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchmarkResult
+{
+	std::string name;
+	int iterations = 0;
+	std::vector<double> samples;
+
+	double mean = 0.0;
+	double median = 0.0;
+	double stddev = 0.0;
+	double min = 0.0;
+	double max = 0.0;
+};
+
+class Benchmark
+{
+public:
+	int repetitions = 10;
+	double min_time = 0.1;
+	std::string filter = "";
+
+	std::vector<BenchmarkResult> results;
+
+	void run(const std::string &name, std::function<void()> setup, std::function<void()> body)
+	{
+		if (filter != "" && name.find(filter) == std::string::npos)
+			return;
+
+		setup();
+
+		// calibrate the iteration count so one repetition lasts at least min_time
+		int iterations = 1;
+		while (true)
+		{
+			Clock::time_point start = Clock::now();
+			for (int i = 0; i < iterations; i++)
+				body();
+			double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+			if (elapsed >= min_time || iterations >= (1 << 24))
+				break;
+			iterations *= elapsed > 0.0 ? std::clamp((int)(min_time / elapsed * 1.2), 2, 10) : 10;
+		}
+
+		BenchmarkResult result;
+		result.name = name;
+		result.iterations = iterations;
+
+		for (int r = 0; r < repetitions; r++)
+		{
+			Clock::time_point start = Clock::now();
+			for (int i = 0; i < iterations; i++)
+				body();
+			double elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+			result.samples.push_back(elapsed / iterations);
+		}
+
+		std::vector<double> sorted = result.samples;
+		std::sort(sorted.begin(), sorted.end());
+		for (int i = 0; i < sorted.size(); i++)
+			result.mean += sorted[i] / sorted.size();
+		for (int i = 0; i < sorted.size(); i++)
+			result.stddev += (sorted[i] - result.mean) * (sorted[i] - result.mean) / std::max((int)sorted.size() - 1, 1);
+		result.stddev = std::sqrt(result.stddev);
+		result.median = sorted[sorted.size() / 2];
+		result.min = sorted.front();
+		result.max = sorted.back();
+
+		std::cout << std::left << std::setw(48) << name << std::right << std::fixed << std::setprecision(1);
+		std::cout << std::setw(16) << result.median << " ns" << std::setw(12) << result.stddev << " ns  x" << iterations << "\n";
+
+		results.push_back(result);
+	}
+
+	bool writeJson(const std::string &path)
+	{
+		std::ofstream file(path, std::ofstream::out | std::ofstream::trunc);
+		if (!file)
+		{
+			std::cout << "failed to write results: " << path << "\n";
+			return false;
+		}
+
+		file << std::fixed << std::setprecision(3);
+		file << "{\n\t\"unit\": \"ns\",\n\t\"repetitions\": " << repetitions << ",\n\t\"benchmarks\": [\n";
+		for (int i = 0; i < results.size(); i++)
+		{
+			BenchmarkResult &result = results[i];
+			file << "\t\t{\"name\": \"" << result.name << "\", \"iterations\": " << result.iterations;
+			file << ", \"mean\": " << result.mean << ", \"median\": " << result.median << ", \"stddev\": " << result.stddev;
+			file << ", \"min\": " << result.min << ", \"max\": " << result.max << ", \"samples\": [";
+			for (int j = 0; j < result.samples.size(); j++)
+				file << (j ? ", " : "") << result.samples[j];
+			file << "]}" << (i + 1 < results.size() ? "," : "") << "\n";
+		}
+		file << "\t]\n}\n";
+
+		std::cout << "wrote results: " << path << "\n";
+		return true;
+	}
+};
+
+void generateBodies(Solarsystem &system, int count)
+{
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	Planet *sun = new Planet;
+	sun->name = "S1";
+	sun->id = 0;
+	sun->radius = 8.0f;
+	sun->mass = 10000.0f;
+	system.planets.push_back(sun);
+
+	for (int i = 1; i < count; i++)
+	{
+		Planet *planet = new Planet;
+		planet->id = i;
+		planet->name = "B" + std::to_string(i);
+		planet->radius = 0.1f + unit(random);
+
+		// every fourth body is a moon of an earlier one so the hierarchy gets some depth
+		planet->orbit_anchor = (i % 4 == 0 && i > 4) ? system.planets[i - 3] : sun;
+		planet->orbit_radius = planet->orbit_anchor == sun ? 20.0f + unit(random) * 500.0f : 2.0f + unit(random) * 4.0f;
+		planet->orbit_speed = (unit(random) - 0.5f) * 2.0f;
+		planet->orbit_offset = unit(random) * 6.28f;
+		planet->rotation_speed = unit(random);
+		planet->orbit_axis = glm::normalize(glm::vec3(unit(random) - 0.5f, unit(random) - 0.5f, 2.0f));
+		planet->pole_axis = glm::normalize(glm::vec3(unit(random) - 0.5f, unit(random) - 0.5f, 2.0f));
+		planet->rotation_axis = planet->pole_axis;
+		system.planets.push_back(planet);
+	}
+}
+
+void initializeState(Solarsystem &system, SimulationState &state)
+{
+	state.bodies.resize(system.planets.size());
+	for (int i = 0; i < system.planets.size(); i++)
+	{
+		state.bodies[i].orbit_offset = system.planets[i]->orbit_offset;
+		state.bodies[i].orbit_speed = system.planets[i]->orbit_speed;
+		state.bodies[i].radius = system.planets[i]->radius;
+		state.bodies[i].mass = system.planets[i]->mass;
+	}
+	system.updatePlanets(state, 0.0f);
+}
+
+int main(int argc, char **argv)
+{
+	Benchmark benchmark;
+	std::string output_path = "bench_results.json";
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg == "--repetitions" && i + 1 < argc)
+			benchmark.repetitions = std::stoi(argv[++i]);
+		else if (arg == "--min-time" && i + 1 < argc)
+			benchmark.min_time = std::stod(argv[++i]);
+		else if (arg == "--filter" && i + 1 < argc)
+			benchmark.filter = argv[++i];
+		else if (arg == "--out" && i + 1 < argc)
+			output_path = argv[++i];
+	}
+
+	// mesh generation, cleared each iteration so only the build itself is timed
+	Planet mesh_planet;
+	benchmark.run("Planet::generateMesh", [] {}, [&]
+	{
+		mesh_planet.body_vertices.clear();
+		mesh_planet.body_indices.clear();
+		mesh_planet.orbit_vertices.clear();
+		mesh_planet.axis_vertices.clear();
+		mesh_planet.generateMesh();
+	});
+
+	// one simulation step at increasing body counts
+	for (int count : {10, 100, 1000, 10000, 100000})
+	{
+		Solarsystem system;
+		SimulationState state;
+		benchmark.run("Solarsystem::updatePlanets/" + std::to_string(count), [&]
+		{
+			generateBodies(system, count);
+			initializeState(system, state);
+		}, [&]
+		{
+			system.updatePlanets(state, 1.0f / 240.0f);
+		});
+		for (int i = 0; i < system.planets.size(); i++)
+			delete system.planets[i];
+	}
+
+	// one time warped gravity step, a few tight moons force deep levels on a system that otherwise steps coarsely
+	for (bool individual : {true, false})
+	{
+		Solarsystem system;
+		SimulationState state;
+		Gravity gravity;
+		gravity.individual = individual;
+		benchmark.run(std::string("Gravity::advance/") + (individual ? "block" : "global"), [&]
+		{
+			generateBodies(system, 200);
+			for (int i = 1; i < system.planets.size(); i++)
+				system.planets[i]->mass = system.planets[i]->orbit_anchor == system.planets[0] ? 10.0f : 0.01f;
+			initializeState(system, state);
+			gravity.enable(state, system.planets);
+		}, [&]
+		{
+			gravity.advance(state, 0.25f);
+		});
+		for (int i = 0; i < system.planets.size(); i++)
+			delete system.planets[i];
+	}
+
+	// ephemeris lookups at scattered times, baked from the scripted orbits over a short span
+	for (int count : {1000, 100000})
+	{
+		Solarsystem system;
+		SimulationState state;
+		Ephemeris ephemeris;
+		std::string path = (std::filesystem::temp_directory_path() / "helios_bench.heph").string();
+		double time = 0.0;
+		benchmark.run("Ephemeris::evaluate/" + std::to_string(count), [&]
+		{
+			generateBodies(system, count);
+			initializeState(system, state);
+			Ephemeris::bake(path, state, system.planets, 16.0, 1.0, 12, [&](SimulationState &state, float delta_time)
+			{
+				system.updatePlanets(state, delta_time);
+			});
+			ephemeris.load(path, {});
+		}, [&]
+		{
+			time = std::fmod(time + 3.7, 16.0);
+			ephemeris.evaluate(time);
+		});
+		ephemeris.file.close();
+		std::filesystem::remove(path);
+		for (int i = 0; i < system.planets.size(); i++)
+			delete system.planets[i];
+	}
+
+	// picking against random bounding spheres, refit as every frame does, then one ray through the field
+	for (int count : {10000, 1000000})
+	{
+		Bvh bvh;
+		benchmark.run("Bvh::refit/" + std::to_string(count), [&]
+		{
+			std::mt19937 random(2);
+			std::uniform_real_distribution<float> unit(-1000.0f, 1000.0f);
+			bvh.spheres.resize(count);
+			for (int i = 0; i < count; i++)
+				bvh.spheres[i] = glm::vec4(unit(random), unit(random), unit(random), 0.5f);
+			bvh.build();
+		}, [&]
+		{
+			bvh.refit();
+		});
+
+		glm::vec3 direction = glm::normalize(glm::vec3(1.0f, 0.3f, 0.2f));
+		benchmark.run("Bvh::raycast/" + std::to_string(count), [] {}, [&]
+		{
+			float distance;
+			bvh.raycast(glm::vec3(-1500.0f, -400.0f, -300.0f), direction, distance);
+		});
+	}
+
+	Planet matrix_planet;
+	matrix_planet.position = glm::vec3(10.0f, 20.0f, 30.0f);
+	matrix_planet.pole_axis = glm::normalize(glm::vec3(0.1f, -0.2f, 1.0f));
+	matrix_planet.orbit_axis = glm::normalize(glm::vec3(0.8f, 0.0f, 1.0f));
+	matrix_planet.orbit_radius = 10.0f;
+	benchmark.run("Planet::updateModelMatrix", [] {}, [&]
+	{
+		matrix_planet.rotation_offset += 0.001f;
+		matrix_planet.body_dirty = true;
+		matrix_planet.updateModelMatrix();
+	});
+
+	// label meshes from the real font metrics
+	for (int length : {64, 1024, 16384})
+	{
+		Label label;
+		benchmark.run("Label::generateMesh/" + std::to_string(length), [&]
+		{
+			label.generateFont();
+			for (int i = 0; i < length; i++)
+				label.text += (i % 48 == 47) ? '\n' : (char)('a' + i % 26);
+		}, [&]
+		{
+			label.generateMesh();
+		});
+	}
+
+	benchmark.run("Label::generateFont", [] {}, []
+	{
+		Label label;
+		label.generateFont();
+	});
+
+	for (std::string texture : {"res/textures/2k_neptune.jpg", "res/textures/4k_venus_atmosphere.jpg"})
+	{
+		benchmark.run("stbi_load/" + texture.substr(texture.find_last_of('/') + 1), [] {}, [&]
+		{
+			int width, height, channels;
+			stbi_set_flip_vertically_on_load(true);
+			unsigned char *data = stbi_load(texture.c_str(), &width, &height, &channels, 0);
+			stbi_image_free(data);
+		});
+	}
+
+	benchmark.writeJson(output_path);
+	return 0;
+}
\ No newline at end of file
@@ -1,4 +1,4 @@
-#version 460 core
+#version 450 core
 
 struct Material {
     vec3 color;
@@ -9,11 +9,10 @@ struct Material {
 };
 
 struct Light {
-    vec3 position;
-    vec3 color;
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
+    vec4 position;
+    vec4 color;
+    vec4 diffuse;
+    vec4 specular;
 };
 
 in vec3 frag_pos;
@@ -25,26 +24,78 @@ uniform sampler2D body_texture;
 uniform vec3 view_pos;
 
 uniform Material material;
-uniform Light light;
+
+// every light in the scene, each body gets the indices of the few that reach it
+layout(std430, binding = 1) readonly buffer Lights {
+    Light lights[];
+};
+
+uniform vec3 ambient;
+uniform int light_count;
+uniform int light_indices[8];
+
+// spheres that may stand between this body and its lights, as center and radius
+uniform int occluder_count;
+uniform vec4 occluders[4];
 
 out vec4 frag_color;
 
+// fraction of the light disc left uncovered by the occluder discs, both seen from this fragment
+float getVisibility(Light light, vec3 to_light)
+{
+    float light_distance = length(to_light);
+    float light_angle = asin(clamp(light.color.w / light_distance, 0.0f, 1.0f));
+    vec3 light_dir = to_light / light_distance;
+
+    float visibility = 1.0f;
+    for (int i = 0; i < occluder_count; i++)
+    {
+        vec3 to_occluder = occluders[i].xyz - frag_pos;
+        float occluder_distance = length(to_occluder);
+        if (occluder_distance >= light_distance || dot(to_occluder, light_dir) <= 0.0f)
+            continue;
+
+        float occluder_angle = asin(clamp(occluders[i].w / occluder_distance, 0.0f, 1.0f));
+        float separation = acos(clamp(dot(to_occluder / occluder_distance, light_dir), -1.0f, 1.0f));
+
+        // full overlap when one disc lies inside the other, none once they no longer touch
+        float smaller = min(light_angle, occluder_angle);
+        float coverage = (smaller * smaller) / max(light_angle * light_angle, 1e-8f);
+        float overlap = 1.0f - smoothstep(abs(light_angle - occluder_angle), light_angle + occluder_angle, separation);
+        visibility *= 1.0f - coverage * overlap;
+    }
+    return visibility;
+}
+
 void main()
 {
     vec3 norm = normalize(normal);
-    vec3 light_dir = normalize(light.position - frag_pos);
     vec3 view_dir = normalize(view_pos - frag_pos);
-    vec3 reflect_dir = reflect(-light_dir, norm);
 
-    vec3 ambient = light.ambient * material.ambient;
+    // ambient is added once, independent of which lights reach the body
+    vec3 lum = ambient * material.ambient;
+    for (int i = 0; i < light_count; i++)
+    {
+        Light light = lights[light_indices[i]];
+        vec3 to_light = light.position.xyz - frag_pos;
+        vec3 light_dir = normalize(to_light);
+        vec3 reflect_dir = reflect(-light_dir, norm);
+
+        // windowed so the light reaches exactly zero at its range
+        float ratio = length(to_light) / light.position.w;
+        float falloff = clamp(1.0f - ratio * ratio * ratio * ratio, 0.0f, 1.0f);
+        falloff *= falloff;
+
+        float diff = max(dot(norm, light_dir), 0.0f);
+        vec3 diffuse = light.diffuse.rgb * (diff *  material.diffuse);
 
-    float diff = max(dot(norm, light_dir), 0.0f);
-    vec3 diffuse = light.diffuse * (diff *  material.diffuse);
+        float spec = pow(max(dot(view_dir, reflect_dir), 0.0f), material.shininess);
+        vec3 specular = light.specular.rgb * (spec * material.specular);
 
-    float spec = pow(max(dot(view_dir, reflect_dir), 0.0f), material.shininess);
-    vec3 specular = light.specular * (spec * material.specular);
+        float shadow = occluder_count > 0 ? getVisibility(light, to_light) : 1.0f;
 
-    vec3 lum = ambient + diffuse + specular;
+        lum += (diffuse + specular) * shadow * light.color.rgb * falloff;
+    }
 
-    frag_color = vec4(lum, 1.0f) * color * vec4(light.color, 1.0f) * vec4(material.color, 1.0f) * texture(body_texture, tex_coord);
+    frag_color = vec4(lum, 1.0f) * color * vec4(material.color, 1.0f) * texture(body_texture, tex_coord);
 }
\ No newline at end of file
@@ -0,0 +1,66 @@
+#version 450 core
+
+struct TerrainVertex {
+    vec4 position;
+    vec4 normal;
+};
+
+// the chunk's own vertices, pulled by index since every chunk shares one index buffer
+layout(std430, binding = 2) readonly buffer Vertices {
+    TerrainVertex vertices[];
+};
+
+out vec3 frag_pos;
+out vec3 normal;
+out vec2 tex_coord;
+out vec4 color;
+
+// body orientation scaled by its radius, the chunk center is already relative to the camera
+uniform mat3 rotation;
+uniform mat3 view_rotation;
+uniform mat4 projection;
+uniform vec3 chunk_offset;
+uniform vec3 view_pos;
+
+uniform int grid;
+// bottom, right, top, left, how many of this chunk's vertices span one vertex spacing of the neighbour there
+uniform ivec4 edge_steps;
+
+int getIndex(int i, int j)
+{
+    return j * (grid + 1) + i;
+}
+
+void main()
+{
+    int i = gl_VertexID % (grid + 1);
+    int j = gl_VertexID / (grid + 1);
+    TerrainVertex vertex = vertices[gl_VertexID];
+
+    // vertices on an edge against a coarser chunk slide onto the straight segment it draws there, closing the crack
+    int step = 1;
+    int along = 0;
+    if (j == 0) { step = edge_steps.x; along = i; }
+    else if (i == grid) { step = edge_steps.y; along = j; }
+    else if (j == grid) { step = edge_steps.z; along = i; }
+    else if (i == 0) { step = edge_steps.w; along = j; }
+
+    int remainder = along % step;
+    if (remainder != 0)
+    {
+        int first = along - remainder;
+        int second = first + step;
+        int a = j == 0 ? getIndex(first, 0) : i == grid ? getIndex(grid, first) : j == grid ? getIndex(first, grid) : getIndex(0, first);
+        int b = j == 0 ? getIndex(second, 0) : i == grid ? getIndex(grid, second) : j == grid ? getIndex(second, grid) : getIndex(0, second);
+        float t = float(remainder) / float(step);
+        vertex.position = mix(vertices[a].position, vertices[b].position, t);
+        vertex.normal = mix(vertices[a].normal, vertices[b].normal, t);
+    }
+
+    vec3 relative = chunk_offset + rotation * vertex.position.xyz;
+    gl_Position = projection * vec4(view_rotation * relative, 1.0f);
+    frag_pos = view_pos + relative;
+    normal = rotation * vertex.normal.xyz;
+    tex_coord = vec2(vertex.position.w, vertex.normal.w);
+    color = vec4(1.0f);
+}
\ No newline at end of file
@@ -0,0 +1,16 @@
+#version 450 core
+
+in float age;
+in float valid;
+
+out vec4 frag_color;
+
+uniform vec4 color;
+
+void main()
+{
+    if (valid < 0.999f)
+        discard;
+
+    frag_color = vec4(color.rgb, color.a * (1.0f - age) * (1.0f - age));
+}
\ No newline at end of file
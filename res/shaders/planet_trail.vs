@@ -0,0 +1,30 @@
+#version 450 core
+
+layout (std430, binding = 0) readonly buffer Samples
+{
+    vec4 samples[];
+};
+
+out float age;
+out float valid;
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform int body_count;
+uniform int sample_count;
+uniform int segment_count;
+uniform int head;
+
+void main()
+{
+    int segment = gl_VertexID / 2;
+    int body = segment / segment_count;
+    int index = segment % segment_count + gl_VertexID % 2;
+    int row = (head - segment_count + index + sample_count) % sample_count;
+
+    vec4 sample_pos = samples[row * body_count + body];
+    age = float(segment_count - index) / float(segment_count);
+    valid = sample_pos.w;
+
+    gl_Position = projection * view * vec4(sample_pos.xyz, 1.0f);
+}
\ No newline at end of file
@@ -0,0 +1,12 @@
+#version 450 core
+
+in vec3 direction;
+
+uniform samplerCube sky_texture;
+
+out vec4 frag_color;
+
+void main()
+{
+    frag_color = texture(sky_texture, direction);
+}
\ No newline at end of file
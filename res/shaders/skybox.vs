@@ -0,0 +1,14 @@
+#version 450 core
+
+out vec3 direction;
+
+uniform mat4 inverse_view_projection;
+
+void main()
+{
+    vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2) * 2.0f - 1.0f;
+    // unprojected from the near plane, with the far plane a million units out it maps to infinity in float
+    vec4 world_pos = inverse_view_projection * vec4(position, -1.0f, 1.0f);
+    direction = world_pos.xyz / world_pos.w;
+    gl_Position = vec4(position, 1.0f, 1.0f);
+}
\ No newline at end of file
@@ -0,0 +1,13 @@
+#version 450 core
+
+in vec4 color;
+
+out vec4 frag_color;
+
+void main()
+{
+    // round gaussian spot instead of a square point
+    vec2 offset = gl_PointCoord * 2.0f - 1.0f;
+    float falloff = exp(-4.0f * dot(offset, offset));
+    frag_color = vec4(color.rgb, color.a * falloff);
+}
\ No newline at end of file
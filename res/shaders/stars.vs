@@ -0,0 +1,24 @@
+#version 450 core
+
+layout (location = 0) in vec3 direction;
+layout (location = 1) in float magnitude;
+layout (location = 2) in vec4 star_color;
+
+out vec4 color;
+
+uniform mat4 view_projection;
+uniform float limit_magnitude;
+uniform float point_scale;
+uniform float max_point_size;
+
+void main()
+{
+    // flux relative to the faintest drawn star, so stars fade in at the limit instead of popping
+    float flux = pow(10.0f, -0.4f * (magnitude - limit_magnitude));
+    gl_PointSize = clamp(point_scale * pow(flux, 0.25f), point_scale, max_point_size);
+    color = vec4(star_color.rgb, clamp(0.25f * flux, 0.1f, 1.0f));
+
+    // pinned to the far plane, anything in front of it covers the star
+    vec4 position = view_projection * vec4(direction, 1.0f);
+    gl_Position = position.xyww;
+}
\ No newline at end of file
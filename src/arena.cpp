@@ -0,0 +1,118 @@
+#include "arena.h"
+
+#include <atomic>
+#include <algorithm>
+#include <cstdlib>
+#include <cstdarg>
+#include <cstdio>
+#include <new>
+
+static std::atomic<uint64_t> allocation_count = 0;
+static thread_local uint64_t thread_allocation_count = 0;
+
+// replacing the global operators is what makes the counters see every container, string and closure in the program
+void *operator new(size_t size)
+{
+	allocation_count.fetch_add(1, std::memory_order_relaxed);
+	thread_allocation_count += 1;
+
+	void *pointer = std::malloc(size ? size : 1);
+	if (!pointer)
+		throw std::bad_alloc();
+	return pointer;
+}
+
+void operator delete(void *pointer) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept
+{
+	std::free(pointer);
+}
+
+uint64_t getAllocationCount()
+{
+	return allocation_count.load(std::memory_order_relaxed);
+}
+
+uint64_t getThreadAllocationCount()
+{
+	return thread_allocation_count;
+}
+
+Arena::~Arena()
+{
+	reset();
+	delete[] data;
+}
+
+void *Arena::allocate(size_t size, size_t alignment)
+{
+	if (!data)
+	{
+		capacity = std::max(initial_capacity, peak);
+		data = new char[capacity];
+	}
+
+	size_t aligned = (offset + alignment - 1) & ~(alignment - 1);
+	if (aligned + size <= capacity)
+	{
+		offset = aligned + size;
+		return data + aligned;
+	}
+
+	// out of space this frame, the heap keeps things going and reset grows the block to fit next time
+	char *block = new char[size + alignment];
+	overflow.push_back(block);
+	overflow_bytes += size + alignment;
+	return (void *)(((uintptr_t)block + alignment - 1) & ~(uintptr_t)(alignment - 1));
+}
+
+void Arena::reset()
+{
+	peak = std::max(peak, getUsed());
+
+	for (int i = 0; i < overflow.size(); i++)
+		delete[] overflow[i];
+	overflow.clear();
+	overflow_bytes = 0;
+	offset = 0;
+
+	if (data && peak > capacity)
+	{
+		delete[] data;
+		capacity = peak + peak / 2;
+		data = new char[capacity];
+	}
+}
+
+size_t Arena::getUsed()
+{
+	return offset + overflow_bytes;
+}
+
+Arena &frameArena()
+{
+	static thread_local Arena arena;
+	return arena;
+}
+
+void appendFormat(FrameString &string, const char *format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	va_list measure;
+	va_copy(measure, args);
+	int length = std::vsnprintf(nullptr, 0, format, measure);
+	va_end(measure);
+
+	if (length > 0)
+	{
+		size_t start = string.size();
+		string.resize(start + length);
+		std::vsnprintf(&string[start], length + 1, format, args);
+	}
+	va_end(args);
+}
\ No newline at end of file
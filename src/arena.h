@@ -0,0 +1,71 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// bump allocator for memory that only lives until the end of the current frame, one per thread.
+// freeing is a no-op, everything goes at once on reset
+class Arena
+{
+public:
+	static constexpr size_t initial_capacity = 256 * 1024;
+
+	char *data = nullptr;
+	size_t capacity = 0;
+	size_t offset = 0;
+
+	// requests that did not fit, taken from the heap and only released on reset
+	std::vector<char *> overflow;
+	size_t overflow_bytes = 0;
+
+	// most ever used between two resets, the next block is sized to hold it so overflow stops after warmup
+	size_t peak = 0;
+
+	Arena() = default;
+	Arena(const Arena &) = delete;
+	Arena &operator=(const Arena &) = delete;
+	~Arena();
+
+	void *allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+	void reset();
+	size_t getUsed();
+};
+
+// the calling thread's arena
+Arena &frameArena();
+
+// every general purpose heap allocation is counted, for the whole process and for the calling thread
+uint64_t getAllocationCount();
+uint64_t getThreadAllocationCount();
+
+template<typename T>
+class ArenaAllocator
+{
+public:
+	using value_type = T;
+
+	Arena *arena;
+
+	ArenaAllocator() : arena(&frameArena()) {}
+	ArenaAllocator(Arena &arena) : arena(&arena) {}
+	template<typename U>
+	ArenaAllocator(const ArenaAllocator<U> &other) : arena(other.arena) {}
+
+	T *allocate(size_t count) { return (T *)arena->allocate(count * sizeof(T), alignof(T)); }
+	void deallocate(T *, size_t) {}
+
+	template<typename U>
+	bool operator==(const ArenaAllocator<U> &other) const { return arena == other.arena; }
+	template<typename U>
+	bool operator!=(const ArenaAllocator<U> &other) const { return arena != other.arena; }
+};
+
+// containers for scratch data, must not be kept past the end of the frame they were made in
+template<typename T>
+using FrameVector = std::vector<T, ArenaAllocator<T>>;
+using FrameString = std::basic_string<char, std::char_traits<char>, ArenaAllocator<char>>;
+
+// printf style formatting appended to a frame string, without the temporaries of to_string and operator+
+void appendFormat(FrameString &string, const char *format, ...);
\ No newline at end of file
@@ -0,0 +1,249 @@
+#include "bvh.h"
+#include "global.h"
+#include "profiler.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+void Bvh::build()
+{
+	PROFILE_SCOPE("Bvh::build");
+
+	items.resize(spheres.size());
+	for (int i = 0; i < spheres.size(); i++)
+		items[i] = i;
+
+	nodes.clear();
+	nodes.reserve(items.empty() ? 0 : 2 * items.size() / leaf_size + 1);
+	if (!items.empty())
+		buildNode(0, (int)items.size());
+
+	area = 0.0f;
+	for (int i = 0; i < nodes.size(); i++)
+	{
+		if (nodes[i].count == 0)
+			area += getArea(nodes[i]);
+	}
+	built_area = area;
+}
+
+int Bvh::buildNode(int begin, int end)
+{
+	int index = (int)nodes.size();
+	nodes.push_back(BvhNode());
+
+	if (end - begin <= leaf_size)
+	{
+		nodes[index].first = begin;
+		nodes[index].count = end - begin;
+		fitLeaf(nodes[index]);
+		return index;
+	}
+
+	// median split along the widest spread of centers, balanced so depth stays logarithmic however bodies cluster
+	glm::vec3 lower = glm::vec3(std::numeric_limits<float>::max());
+	glm::vec3 upper = glm::vec3(-std::numeric_limits<float>::max());
+	for (int i = begin; i < end; i++)
+	{
+		lower = glm::min(lower, glm::vec3(spheres[items[i]]));
+		upper = glm::max(upper, glm::vec3(spheres[items[i]]));
+	}
+	glm::vec3 spread = upper - lower;
+	int axis = spread.x > spread.y ? (spread.x > spread.z ? 0 : 2) : (spread.y > spread.z ? 1 : 2);
+
+	int middle = (begin + end) / 2;
+	std::nth_element(items.begin() + begin, items.begin() + middle, items.begin() + end, [&](int a, int b)
+	{
+		return spheres[a][axis] < spheres[b][axis];
+	});
+
+	buildNode(begin, middle);
+	int second = buildNode(middle, end);
+
+	BvhNode &node = nodes[index];
+	node.first = second;
+	node.count = 0;
+	node.lower = glm::min(nodes[index + 1].lower, nodes[second].lower);
+	node.upper = glm::max(nodes[index + 1].upper, nodes[second].upper);
+	return index;
+}
+
+void Bvh::refit()
+{
+	PROFILE_SCOPE("Bvh::refit");
+
+	// the topology is kept and only the bounds follow the bodies, leaves first so parents can merge finished children
+	jobs.parallelFor((int)nodes.size(), grain, [&](int begin, int end)
+	{
+		for (int i = begin; i < end; i++)
+		{
+			if (nodes[i].count > 0)
+				fitLeaf(nodes[i]);
+		}
+	});
+
+	// children always come after their parent, walking backwards sees every child before its parent
+	area = 0.0f;
+	for (int i = (int)nodes.size() - 1; i >= 0; i--)
+	{
+		BvhNode &node = nodes[i];
+		if (node.count > 0)
+			continue;
+
+		node.lower = glm::min(nodes[i + 1].lower, nodes[node.first].lower);
+		node.upper = glm::max(nodes[i + 1].upper, nodes[node.first].upper);
+		area += getArea(node);
+	}
+
+	// the grouping made sense for where items were at build time, once nodes overlap this much more queries pay for it
+	if (area > built_area * rebuild_ratio)
+		build();
+}
+
+float Bvh::getArea(const BvhNode &node)
+{
+	glm::vec3 size = node.upper - node.lower;
+	return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+void Bvh::fitLeaf(BvhNode &node)
+{
+	node.lower = glm::vec3(std::numeric_limits<float>::max());
+	node.upper = glm::vec3(-std::numeric_limits<float>::max());
+	for (int i = node.first; i < node.first + node.count; i++)
+	{
+		glm::vec4 sphere = spheres[items[i]];
+		node.lower = glm::min(node.lower, glm::vec3(sphere) - glm::vec3(sphere.w));
+		node.upper = glm::max(node.upper, glm::vec3(sphere) + glm::vec3(sphere.w));
+	}
+}
+
+void Bvh::overlap(glm::vec4 sphere, FrameVector<int> &result)
+{
+	if (nodes.empty())
+		return;
+
+	glm::vec3 center = glm::vec3(sphere);
+	int stack[64];
+	int size = 0;
+	stack[size++] = 0;
+	while (size > 0)
+	{
+		int index = stack[--size];
+		const BvhNode &node = nodes[index];
+
+		// closest point of the box against the query sphere
+		glm::vec3 closest = glm::clamp(center, node.lower, node.upper);
+		glm::vec3 offset = closest - center;
+		if (glm::dot(offset, offset) > sphere.w * sphere.w)
+			continue;
+
+		if (node.count > 0)
+		{
+			for (int i = node.first; i < node.first + node.count; i++)
+			{
+				glm::vec4 item = spheres[items[i]];
+				glm::vec3 between = glm::vec3(item) - center;
+				float reach = item.w + sphere.w;
+				if (item.w > 0.0f && glm::dot(between, between) <= reach * reach)
+					result.push_back(items[i]);
+			}
+			continue;
+		}
+
+		stack[size++] = node.first;
+		stack[size++] = index + 1;
+	}
+}
+
+int Bvh::raycast(glm::vec3 origin, glm::vec3 direction, float &distance)
+{
+	PROFILE_SCOPE("Bvh::raycast");
+
+	int result = -1;
+	distance = std::numeric_limits<float>::max();
+	if (nodes.empty())
+		return result;
+
+	glm::vec3 inverse = 1.0f / direction;
+
+	// depth first, nearer child first, skipping every box that starts beyond the closest hit so far
+	int stack[64];
+	int size = 0;
+	stack[size++] = 0;
+	while (size > 0)
+	{
+		const BvhNode &node = nodes[stack[--size]];
+		float entry;
+		if (!intersectBox(node, origin, inverse, distance, entry))
+			continue;
+
+		if (node.count > 0)
+		{
+			for (int i = node.first; i < node.first + node.count; i++)
+			{
+				float hit;
+				if (intersectSphere(spheres[items[i]], origin, direction, hit) && hit < distance)
+				{
+					distance = hit;
+					result = items[i];
+				}
+			}
+			continue;
+		}
+
+		int first = (int)(&node - nodes.data()) + 1;
+		int second = node.first;
+		float first_entry;
+		float second_entry;
+		bool first_hit = intersectBox(nodes[first], origin, inverse, distance, first_entry);
+		bool second_hit = intersectBox(nodes[second], origin, inverse, distance, second_entry);
+		if (first_hit && second_hit && second_entry < first_entry)
+		{
+			std::swap(first, second);
+			std::swap(first_hit, second_hit);
+		}
+
+		if (second_hit)
+			stack[size++] = second;
+		if (first_hit)
+			stack[size++] = first;
+	}
+
+	return result;
+}
+
+bool Bvh::intersectBox(const BvhNode &node, glm::vec3 origin, glm::vec3 inverse, float limit, float &distance)
+{
+	glm::vec3 near_hit = (node.lower - origin) * inverse;
+	glm::vec3 far_hit = (node.upper - origin) * inverse;
+	glm::vec3 low = glm::min(near_hit, far_hit);
+	glm::vec3 high = glm::max(near_hit, far_hit);
+
+	float enter = std::max(std::max(low.x, low.y), std::max(low.z, 0.0f));
+	float exit = std::min(std::min(high.x, high.y), std::min(high.z, limit));
+	distance = enter;
+	return enter <= exit;
+}
+
+bool Bvh::intersectSphere(glm::vec4 sphere, glm::vec3 origin, glm::vec3 direction, float &distance)
+{
+	if (sphere.w <= 0.0f)
+		return false;
+
+	glm::vec3 offset = origin - glm::vec3(sphere);
+	float b = glm::dot(offset, direction);
+	float c = glm::dot(offset, offset) - sphere.w * sphere.w;
+	float discriminant = b * b - c;
+	if (discriminant < 0.0f)
+		return false;
+
+	// the far side counts when the ray starts inside the sphere
+	float root = std::sqrt(discriminant);
+	distance = -b - root >= 0.0f ? -b - root : -b + root;
+	return distance >= 0.0f;
+}
\ No newline at end of file
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "arena.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+struct BvhNode
+{
+	glm::vec3 lower = glm::vec3(0.0f);
+	// leaves index their first item, inner nodes their second child, the first child always directly follows
+	int first = 0;
+	glm::vec3 upper = glm::vec3(0.0f);
+	int count = 0;
+};
+
+class Bvh
+{
+public:
+	int leaf_size = 4;
+	int grain = 4096;
+
+	// summed surface area of the inner nodes, refitting lets it grow as items drift apart, past this ratio the tree is rebuilt
+	float rebuild_ratio = 1.5f;
+	float built_area = 0.0f;
+	float area = 0.0f;
+
+	// xyz center and w radius, a zero radius hides the sphere until the next refit
+	std::vector<glm::vec4> spheres;
+	std::vector<BvhNode> nodes;
+	std::vector<int> items;
+
+	void build();
+	int buildNode(int begin, int end);
+	void refit();
+	float getArea(const BvhNode &node);
+	void fitLeaf(BvhNode &node);
+	void overlap(glm::vec4 sphere, FrameVector<int> &result);
+	int raycast(glm::vec3 origin, glm::vec3 direction, float &distance);
+	bool intersectBox(const BvhNode &node, glm::vec3 origin, glm::vec3 inverse, float limit, float &distance);
+	bool intersectSphere(glm::vec4 sphere, glm::vec3 origin, glm::vec3 direction, float &distance);
+};
\ No newline at end of file
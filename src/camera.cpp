@@ -5,6 +5,8 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <cmath>
+
 Camera::Camera()
 {
 	updateCameraVectors();
@@ -59,6 +61,12 @@ void Camera::processMouseMovement(float offset_x, float offset_y)
 	updateCameraVectors();
 }
 
+void Camera::zoom(float amount)
+{
+	// multiplicative, so each scroll step feels the same at any field of view
+	fov = glm::clamp(fov * std::pow(0.9f, amount), min_fov, max_fov);
+}
+
 void Camera::updateCameraVectors()
 {
 	glm::vec3 view_dir{};
@@ -78,5 +86,52 @@ void Camera::updateViewMatrix()
 
 void Camera::updateProjectionMatrix()
 {
-	projection = glm::perspective(glm::radians(fov), 1920.0f / 1080.0f, 0.01f, 1000000.0f);
+	projection = glm::perspective(glm::radians(fov), resolution.x / resolution.y, near_plane, 1000000.0f);
+	updateFrustum();
+}
+
+void Camera::updateFrustum()
+{
+	// planes read straight off the rows of the combined matrix
+	glm::mat4 matrix = glm::transpose(projection * view);
+	frustum[0] = matrix[3] + matrix[0];
+	frustum[1] = matrix[3] - matrix[0];
+	frustum[2] = matrix[3] + matrix[1];
+	frustum[3] = matrix[3] - matrix[1];
+	frustum[4] = matrix[3] + matrix[2];
+	frustum[5] = matrix[3] - matrix[2];
+
+	for (int i = 0; i < 6; i++)
+		frustum[i] /= glm::length(glm::vec3(frustum[i]));
+}
+
+bool Camera::isVisible(glm::vec3 center, float radius)
+{
+	for (int i = 0; i < 6; i++)
+	{
+		if (glm::dot(glm::vec3(frustum[i]), center) + frustum[i].w < -radius)
+			return false;
+	}
+	return true;
+}
+
+float Camera::getPixelRadius(glm::vec3 center, float radius)
+{
+	// projected radius on screen, anything containing the camera covers all of it
+	float distance = glm::length(center - position);
+	if (distance <= radius)
+		return resolution.y;
+	return radius / std::sqrt(distance * distance - radius * radius) * projection[1][1] * resolution.y * 0.5f;
+}
+
+void Camera::getRay(glm::vec2 screen, glm::vec3 &origin, glm::vec3 &direction)
+{
+	// unproject the pixel onto the near_point and far_point planes, the ray runs between them
+	glm::vec2 ndc = glm::vec2(2.0f * screen.x / resolution.x - 1.0f, 1.0f - 2.0f * screen.y / resolution.y);
+	glm::mat4 inverse = glm::inverse(projection * view);
+	glm::vec4 near_point = inverse * glm::vec4(ndc, -1.0f, 1.0f);
+	glm::vec4 far_point = inverse * glm::vec4(ndc, 1.0f, 1.0f);
+
+	origin = glm::vec3(near_point) / near_point.w;
+	direction = glm::normalize(glm::vec3(far_point) / far_point.w - origin);
 }
\ No newline at end of file
@@ -18,6 +18,11 @@ public:
 	float speed = 10.0f;
 	float sensitivity = 0.1f;
 	float fov = 90.0f;
+	float min_fov = 1.0f;
+	float max_fov = 90.0f;
+	// pulled in when flying low over terrain, see Terrain::getNearPlane
+	float near_plane = 0.01f;
+	glm::vec2 resolution = glm::vec2(1920.0f, 1080.0f);
 
 	float yaw = 0.0f;
 	float pitch = 0.0f;
@@ -33,11 +38,19 @@ public:
 	glm::mat4 view;
 	glm::mat4 projection;
 
+	// left, right, bottom, top, near, far, normals point inwards
+	glm::vec4 frustum[6];
+
 	Camera();
 	void updatePosition();
 	void applyMovement(Movement movement, float delta_time);
 	void processMouseMovement(float offset_x, float offset_y);
+	void zoom(float amount);
 	void updateCameraVectors();
 	void updateViewMatrix();
 	void updateProjectionMatrix();
+	void updateFrustum();
+	bool isVisible(glm::vec3 center, float radius);
+	float getPixelRadius(glm::vec3 center, float radius);
+	void getRay(glm::vec2 screen, glm::vec3 &origin, glm::vec3 &direction);
 };
\ No newline at end of file
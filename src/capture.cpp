@@ -0,0 +1,351 @@
+#include "capture.h"
+#include "global.h"
+#include "profiler.h"
+
+#include <glad/glad.h>
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <cstring>
+#include <cstdio>
+#include <cstdint>
+#include <filesystem>
+#include <array>
+#include <algorithm>
+
+void Capture::initialize(int width, int height)
+{
+	this->width = width;
+	this->height = height;
+
+	size_t size = (size_t)width * height * 3;
+
+	glGenBuffers(ring_size, pbos);
+	for (int i = 0; i < ring_size; i++)
+	{
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[i]);
+		glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+		pbo_sizes[i] = size;
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	std::filesystem::path directory = std::filesystem::path(path).parent_path();
+	if (!directory.empty())
+		std::filesystem::create_directories(directory);
+
+	if (format == CaptureFormat::VIDEO)
+	{
+		video.open(path, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+		if (!video)
+			std::cout << "failed to open capture stream: " << path << "\n";
+		std::cout << "capturing rgb24 " << width << "x" << height << " at " << fps << " fps to " << path << "\n";
+	}
+}
+
+void Capture::captureFrame(int width, int height)
+{
+	if (!enabled || width <= 0 || height <= 0)
+		return;
+
+	PROFILE_SCOPE("Capture::captureFrame");
+
+	// the slot is reused every ring_size frames, its readback was issued long enough ago to be done
+	if (fences[head])
+		resolve(head);
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[head]);
+	size_t size = (size_t)width * height * 3;
+	if (pbo_sizes[head] < size)
+	{
+		glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+		pbo_sizes[head] = size;
+	}
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, (void *)0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	fences[head] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	slot_frames[head] = frame;
+	slot_widths[head] = width;
+	slot_heights[head] = height;
+
+	head = (head + 1) % ring_size;
+	frame += 1;
+}
+
+void Capture::resolve(int slot)
+{
+	// only blocks if the gpu is more than ring_size frames behind
+	glClientWaitSync(fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+	glDeleteSync(fences[slot]);
+	fences[slot] = 0;
+
+	int width = slot_widths[slot];
+	int height = slot_heights[slot];
+	std::vector<unsigned char> *pixels = acquireBuffer();
+	pixels->resize((size_t)width * height * 3);
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[slot]);
+	void *mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, pixels->size(), GL_MAP_READ_BIT);
+	if (mapped)
+	{
+		memcpy(pixels->data(), mapped, pixels->size());
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	int frame = slot_frames[slot];
+	jobs.submit([this, frame, pixels, width, height] { encode(frame, pixels, width, height); });
+}
+
+void Capture::finish()
+{
+	if (!enabled)
+		return;
+
+	for (int i = 0; i < ring_size; i++)
+	{
+		int slot = (head + i) % ring_size;
+		if (fences[slot])
+			resolve(slot);
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		returned.wait(lock, [this] { return in_flight == 0; });
+	}
+
+	if (video.is_open())
+		video.close();
+
+	glDeleteBuffers(ring_size, pbos);
+	for (int i = 0; i < free_buffers.size(); i++)
+		delete free_buffers[i];
+	free_buffers.clear();
+
+	std::cout << "captured " << frame << " frames\n";
+	enabled = false;
+}
+
+std::vector<unsigned char> *Capture::acquireBuffer()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
+	// encoders fell behind, hold the render loop back instead of queueing frames without bound
+	returned.wait(lock, [this] { return in_flight < max_in_flight; });
+	in_flight += 1;
+
+	if (!free_buffers.empty())
+	{
+		std::vector<unsigned char> *buffer = free_buffers.back();
+		free_buffers.pop_back();
+		return buffer;
+	}
+
+	return new std::vector<unsigned char>((size_t)width * height * 3);
+}
+
+void Capture::releaseBuffer(std::vector<unsigned char> *buffer)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		free_buffers.push_back(buffer);
+		in_flight -= 1;
+	}
+	returned.notify_all();
+}
+
+void Capture::encode(int frame, std::vector<unsigned char> *pixels, int width, int height)
+{
+	PROFILE_SCOPE("Capture::encode");
+
+	// gl rows start at the bottom
+	size_t stride = (size_t)width * 3;
+	std::vector<unsigned char> row(stride);
+	for (int y = 0; y < height / 2; y++)
+	{
+		unsigned char *top = pixels->data() + y * stride;
+		unsigned char *bottom = pixels->data() + (height - 1 - y) * stride;
+		memcpy(row.data(), top, stride);
+		memcpy(top, bottom, stride);
+		memcpy(bottom, row.data(), stride);
+	}
+
+	if (format == CaptureFormat::PNG)
+	{
+		writePng(getFramePath(frame, ".png"), pixels->data(), width, height);
+	}
+	else if (format == CaptureFormat::RAW)
+	{
+		std::ofstream file(getFramePath(frame, ".rgb"), std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+		file.write((const char *)pixels->data(), pixels->size());
+	}
+	else
+	{
+		// the stream has one size for good, a resized window is cropped or padded with black to fit it
+		if (width != this->width || height != this->height)
+		{
+			size_t stream_stride = (size_t)this->width * 3;
+			std::vector<unsigned char> fitted(stream_stride * this->height, 0);
+			size_t copy = std::min(stride, stream_stride);
+			for (int y = 0; y < std::min(height, this->height); y++)
+				memcpy(fitted.data() + y * stream_stride, pixels->data() + y * stride, copy);
+			pixels->swap(fitted);
+		}
+		writeVideo(frame, pixels);
+		return;
+	}
+
+	releaseBuffer(pixels);
+}
+
+void Capture::writeVideo(int frame, std::vector<unsigned char> *pixels)
+{
+	std::vector<std::vector<unsigned char> *> ready;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		pending_video[frame] = pixels;
+
+		// whoever completes the next frame in sequence writes out everything that is now contiguous
+		while (pending_video.count(next_video_frame))
+		{
+			ready.push_back(pending_video[next_video_frame]);
+			pending_video.erase(next_video_frame);
+			next_video_frame += 1;
+		}
+
+		for (int i = 0; i < ready.size(); i++)
+			video.write((const char *)ready[i]->data(), ready[i]->size());
+	}
+
+	for (int i = 0; i < ready.size(); i++)
+		releaseBuffer(ready[i]);
+}
+
+std::string Capture::getFramePath(int frame, const std::string &extension)
+{
+	char number[16];
+	snprintf(number, sizeof(number), "_%06d", frame);
+	return path + number + extension;
+}
+
+void Capture::parseFormat(const std::string &name, CaptureFormat &format)
+{
+	if (name == "png")
+		format = CaptureFormat::PNG;
+	else if (name == "raw")
+		format = CaptureFormat::RAW;
+	else if (name == "video")
+		format = CaptureFormat::VIDEO;
+	else
+		std::cout << "unknown capture format: " << name << "\n";
+}
+
+uint32_t crc32(uint32_t crc, const unsigned char *data, size_t length)
+{
+	static const std::array<uint32_t, 256> table = []
+	{
+		std::array<uint32_t, 256> table;
+		for (uint32_t i = 0; i < 256; i++)
+		{
+			uint32_t c = i;
+			for (int k = 0; k < 8; k++)
+				c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+			table[i] = c;
+		}
+		return table;
+	}();
+
+	crc = ~crc;
+	for (size_t i = 0; i < length; i++)
+		crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+	return ~crc;
+}
+
+void writeChunk(std::ofstream &file, const char *type, const unsigned char *data, uint32_t length)
+{
+	unsigned char header[8] = {
+		(unsigned char)(length >> 24), (unsigned char)(length >> 16), (unsigned char)(length >> 8), (unsigned char)length,
+		(unsigned char)type[0], (unsigned char)type[1], (unsigned char)type[2], (unsigned char)type[3]
+	};
+	uint32_t crc = crc32(crc32(0, header + 4, 4), data, length);
+	unsigned char footer[4] = {(unsigned char)(crc >> 24), (unsigned char)(crc >> 16), (unsigned char)(crc >> 8), (unsigned char)crc};
+
+	file.write((const char *)header, 8);
+	file.write((const char *)data, length);
+	file.write((const char *)footer, 4);
+}
+
+bool Capture::writePng(const std::string &path, const unsigned char *pixels, int width, int height)
+{
+	std::ofstream file(path, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+	if (!file)
+		return false;
+
+	const unsigned char signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+	file.write((const char *)signature, 8);
+
+	unsigned char ihdr[13] = {
+		(unsigned char)(width >> 24), (unsigned char)(width >> 16), (unsigned char)(width >> 8), (unsigned char)width,
+		(unsigned char)(height >> 24), (unsigned char)(height >> 16), (unsigned char)(height >> 8), (unsigned char)height,
+		8, 2, 0, 0, 0
+	};
+	writeChunk(file, "IHDR", ihdr, 13);
+
+	// zlib stream of stored deflate blocks, encoding stays cheap and the frames are meant to be transcoded anyway
+	size_t stride = (size_t)width * 3 + 1;
+	size_t raw_size = stride * height;
+	std::vector<unsigned char> raw(raw_size);
+	for (int y = 0; y < height; y++)
+	{
+		raw[y * stride] = 0;
+		memcpy(&raw[y * stride + 1], pixels + (size_t)y * width * 3, (size_t)width * 3);
+	}
+
+	std::vector<unsigned char> idat;
+	idat.reserve(raw_size + raw_size / 65535 * 5 + 16);
+	idat.push_back(0x78);
+	idat.push_back(0x01);
+
+	uint32_t a = 1;
+	uint32_t b = 0;
+	for (size_t offset = 0; offset < raw_size || offset == 0; offset += 65535)
+	{
+		size_t length = std::min<size_t>(65535, raw_size - offset);
+		idat.push_back(offset + length >= raw_size ? 1 : 0);
+		idat.push_back((unsigned char)length);
+		idat.push_back((unsigned char)(length >> 8));
+		idat.push_back((unsigned char)~length);
+		idat.push_back((unsigned char)(~length >> 8));
+		idat.insert(idat.end(), raw.begin() + offset, raw.begin() + offset + length);
+
+		// 5552 bytes is the most that can be summed before b overflows 32 bits
+		for (size_t i = offset; i < offset + length; i += 5552)
+		{
+			size_t end = std::min(i + 5552, offset + length);
+			for (size_t j = i; j < end; j++)
+			{
+				a += raw[j];
+				b += a;
+			}
+			a %= 65521;
+			b %= 65521;
+		}
+
+		if (raw_size == 0)
+			break;
+	}
+
+	uint32_t adler = (b << 16) | a;
+	idat.push_back((unsigned char)(adler >> 24));
+	idat.push_back((unsigned char)(adler >> 16));
+	idat.push_back((unsigned char)(adler >> 8));
+	idat.push_back((unsigned char)adler);
+
+	writeChunk(file, "IDAT", idat.data(), (uint32_t)idat.size());
+	writeChunk(file, "IEND", nullptr, 0);
+
+	return true;
+}
\ No newline at end of file
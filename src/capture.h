@@ -0,0 +1,67 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <mutex>
+#include <condition_variable>
+#include <map>
+
+enum class CaptureFormat
+{
+	PNG,
+	RAW,
+	VIDEO
+};
+
+class Capture
+{
+public:
+	// frames read back ahead of the one being mapped, enough that mapping never waits on the gpu
+	static constexpr int ring_size = 3;
+	static constexpr int max_in_flight = 16;
+
+	bool enabled = false;
+	CaptureFormat format = CaptureFormat::PNG;
+	std::string path = "capture/frame";
+	float fps = 60.0f;
+
+	// size of the video stream, frames are read back at whatever size the framebuffer has when they are taken
+	int width = 0;
+	int height = 0;
+
+	GLuint pbos[ring_size] = {};
+	size_t pbo_sizes[ring_size] = {};
+	GLsync fences[ring_size] = {};
+	int slot_frames[ring_size] = {};
+	int slot_widths[ring_size] = {};
+	int slot_heights[ring_size] = {};
+	int head = 0;
+	int frame = 0;
+
+	std::vector<std::vector<unsigned char> *> free_buffers;
+	int in_flight = 0;
+	std::mutex mutex;
+	std::condition_variable returned;
+
+	// raw video frames finish encoding out of order but must reach the stream in order
+	std::ofstream video;
+	std::map<int, std::vector<unsigned char> *> pending_video;
+	int next_video_frame = 0;
+
+	void initialize(int width, int height);
+	void captureFrame(int width, int height);
+	void resolve(int slot);
+	void finish();
+
+	std::vector<unsigned char> *acquireBuffer();
+	void releaseBuffer(std::vector<unsigned char> *buffer);
+	void encode(int frame, std::vector<unsigned char> *pixels, int width, int height);
+	void writeVideo(int frame, std::vector<unsigned char> *pixels);
+	std::string getFramePath(int frame, const std::string &extension);
+
+	static bool writePng(const std::string &path, const unsigned char *pixels, int width, int height);
+	static void parseFormat(const std::string &name, CaptureFormat &format);
+};
\ No newline at end of file
@@ -0,0 +1,389 @@
+#include "collisions.h"
+#include "global.h"
+#include "profiler.h"
+#include "arena.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include <mutex>
+#include <algorithm>
+#include <cmath>
+
+void Collisions::reset()
+{
+	previous.clear();
+	touching.clear();
+}
+
+void Collisions::detect(SimulationState &state, float delta_time)
+{
+	// nothing moved, and a paused overlap shouldn't fire every step
+	if (!enabled || delta_time == 0.0f)
+		return;
+
+	PROFILE_SCOPE("Collisions::detect");
+
+	if (previous.size() != state.bodies.size())
+	{
+		previous.resize(state.bodies.size());
+		for (int i = 0; i < state.bodies.size(); i++)
+			previous[i] = state.bodies[i].position;
+	}
+
+	buildGrid(state);
+	findContacts(state);
+	respond(state);
+
+	for (int i = 0; i < state.bodies.size(); i++)
+		previous[i] = state.bodies[i].position;
+}
+
+void Collisions::buildGrid(const SimulationState &state)
+{
+	PROFILE_SCOPE("Collisions::buildGrid");
+
+	int count = (int)state.bodies.size();
+	lower.resize(count);
+	upper.resize(count);
+	entry_counts.resize(count);
+	entry_offsets.resize(count + 1);
+
+	// swept bounds cover the whole path through the step, so fast movers can't skip past each other between steps
+	jobs.parallelFor(count, grain, [&](int begin, int end)
+	{
+		for (int i = begin; i < end; i++)
+		{
+			const BodyState &body = state.bodies[i];
+			glm::vec3 extent = glm::vec3(body.radius);
+			lower[i] = glm::min(previous[i], body.position) - extent;
+			upper[i] = glm::max(previous[i], body.position) + extent;
+		}
+	});
+
+	float extent_sum = 0.0f;
+	int included = 0;
+	for (int i = 0; i < count; i++)
+	{
+		if (!state.bodies[i].active)
+			continue;
+
+		glm::vec3 size = upper[i] - lower[i];
+		extent_sum += std::max(size.x, std::max(size.y, size.z));
+		included += 1;
+	}
+	cell_size = included ? std::max(extent_sum / included, 1e-3f) : 1.0f;
+
+	jobs.parallelFor(count, grain, [&](int begin, int end)
+	{
+		for (int i = begin; i < end; i++)
+		{
+			if (!state.bodies[i].active)
+			{
+				entry_counts[i] = 0;
+				continue;
+			}
+
+			glm::ivec3 span = getCell(upper[i]) - getCell(lower[i]) + glm::ivec3(1);
+			int64_t cells = (int64_t)span.x * span.y * span.z;
+			entry_counts[i] = cells > max_cells ? -1 : (int)cells;
+		}
+	});
+
+	large.clear();
+	entry_offsets[0] = 0;
+	for (int i = 0; i < count; i++)
+	{
+		if (entry_counts[i] < 0)
+			large.push_back(i);
+		entry_offsets[i + 1] = entry_offsets[i] + std::max(entry_counts[i], 0);
+	}
+
+	int entry_count = entry_offsets[count];
+	entries.resize(entry_count);
+	sorted.resize(entry_count);
+
+	jobs.parallelFor(count, grain, [&](int begin, int end)
+	{
+		for (int i = begin; i < end; i++)
+		{
+			if (entry_counts[i] <= 0)
+				continue;
+
+			glm::ivec3 first = getCell(lower[i]);
+			glm::ivec3 last = getCell(upper[i]);
+			int index = entry_offsets[i];
+			for (int x = first.x; x <= last.x; x++)
+				for (int y = first.y; y <= last.y; y++)
+					for (int z = first.z; z <= last.z; z++)
+						entries[index++] = {glm::ivec3(x, y, z), i};
+		}
+	});
+
+	// a power of two at least twice the entry count keeps buckets short without clearing a huge table every step
+	int buckets = 1;
+	while (buckets < entry_count * 2)
+		buckets *= 2;
+	if (buckets > bucket_count)
+	{
+		bucket_counts.reset(new std::atomic<int>[buckets]);
+		bucket_count = buckets;
+	}
+	bucket_offsets.resize(buckets + 1);
+
+	for (int i = 0; i < buckets; i++)
+		bucket_counts[i].store(0, std::memory_order_relaxed);
+
+	jobs.parallelFor(entry_count, grain, [&](int begin, int end)
+	{
+		for (int i = begin; i < end; i++)
+			bucket_counts[hashCell(entries[i].cell) & (buckets - 1)].fetch_add(1, std::memory_order_relaxed);
+	});
+
+	bucket_offsets[0] = 0;
+	for (int i = 0; i < buckets; i++)
+	{
+		bucket_offsets[i + 1] = bucket_offsets[i] + bucket_counts[i].load(std::memory_order_relaxed);
+		bucket_counts[i].store(bucket_offsets[i], std::memory_order_relaxed);
+	}
+
+	jobs.parallelFor(entry_count, grain, [&](int begin, int end)
+	{
+		for (int i = begin; i < end; i++)
+		{
+			int index = bucket_counts[hashCell(entries[i].cell) & (buckets - 1)].fetch_add(1, std::memory_order_relaxed);
+			sorted[index] = entries[i];
+		}
+	});
+}
+
+void Collisions::findContacts(const SimulationState &state)
+{
+	PROFILE_SCOPE("Collisions::findContacts");
+
+	contacts.clear();
+	std::mutex mutex;
+
+	int buckets = (int)bucket_offsets.size() - 1;
+	jobs.parallelFor(buckets, grain * 4, [&](int begin, int end)
+	{
+		FrameVector<Contact> found;
+		for (int bucket = begin; bucket < end; bucket++)
+		{
+			for (int i = bucket_offsets[bucket]; i < bucket_offsets[bucket + 1]; i++)
+			{
+				for (int j = i + 1; j < bucket_offsets[bucket + 1]; j++)
+				{
+					const CellEntry &first = sorted[i];
+					const CellEntry &second = sorted[j];
+
+					// hash collisions share buckets, only bodies in the very same cell are neighbours
+					if (first.cell != second.cell)
+						continue;
+
+					int a = std::min(first.body, second.body);
+					int b = std::max(first.body, second.body);
+					glm::vec3 overlap_lower = glm::max(lower[a], lower[b]);
+					glm::vec3 overlap_upper = glm::min(upper[a], upper[b]);
+					if (glm::any(glm::greaterThan(overlap_lower, overlap_upper)))
+						continue;
+
+					// a pair shares every cell its bounds overlap in, only the cell holding the overlap's corner tests it
+					if (getCell(overlap_lower) != first.cell)
+						continue;
+
+					Contact contact;
+					if (testPair(state, a, b, contact))
+						found.push_back(contact);
+				}
+			}
+		}
+
+		if (!found.empty())
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			contacts.insert(contacts.end(), found.begin(), found.end());
+		}
+	});
+
+	// the few oversized bodies are tested against everything, still linear in the body count
+	int count = (int)state.bodies.size();
+	for (int k = 0; k < large.size(); k++)
+	{
+		int body = large[k];
+		jobs.parallelFor(count, grain, [&](int begin, int end)
+		{
+			FrameVector<Contact> found;
+			for (int i = begin; i < end; i++)
+			{
+				if (i == body || entry_counts[i] == 0 || (entry_counts[i] < 0 && i < body))
+					continue;
+
+				if (glm::any(glm::greaterThan(glm::max(lower[i], lower[body]), glm::min(upper[i], upper[body]))))
+					continue;
+
+				Contact contact;
+				if (testPair(state, std::min(i, body), std::max(i, body), contact))
+					found.push_back(contact);
+			}
+
+			if (!found.empty())
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				contacts.insert(contacts.end(), found.begin(), found.end());
+			}
+		});
+	}
+
+	// buckets finish in any order, sorting keeps the responses deterministic
+	std::sort(contacts.begin(), contacts.end(), [](const Contact &first, const Contact &second)
+	{
+		return first.a != second.a ? first.a < second.a : first.b < second.b;
+	});
+}
+
+bool Collisions::testPair(const SimulationState &state, int a, int b, Contact &contact)
+{
+	const BodyState &first = state.bodies[a];
+	const BodyState &second = state.bodies[b];
+
+	// solve |start + motion * t| = r for the earliest t in the step, relative to the first body
+	glm::vec3 start = previous[b] - previous[a];
+	glm::vec3 motion = (second.position - previous[b]) - (first.position - previous[a]);
+	float distance = first.radius + second.radius;
+
+	float c = glm::dot(start, start) - distance * distance;
+	float time = 0.0f;
+	if (c > 0.0f)
+	{
+		float a2 = glm::dot(motion, motion);
+		float b2 = 2.0f * glm::dot(start, motion);
+		float discriminant = b2 * b2 - 4.0f * a2 * c;
+		if (a2 == 0.0f || discriminant < 0.0f)
+			return false;
+
+		time = (-b2 - std::sqrt(discriminant)) / (2.0f * a2);
+		if (time < 0.0f || time > 1.0f)
+			return false;
+	}
+
+	glm::vec3 position_a = glm::mix(previous[a], first.position, time);
+	glm::vec3 position_b = glm::mix(previous[b], second.position, time);
+	glm::vec3 direction = position_b - position_a;
+	float length = glm::length(direction);
+
+	contact.a = a;
+	contact.b = b;
+	contact.time = time;
+	contact.point = length > 0.0f ? position_a + direction / length * first.radius : position_a;
+	return true;
+}
+
+void Collisions::respond(SimulationState &state)
+{
+	PROFILE_SCOPE("Collisions::respond");
+
+	// contacts persisting from the last step are still reported, but only new ones count as events
+	FrameVector<uint64_t> current;
+	current.reserve(contacts.size());
+	for (int i = 0; i < contacts.size(); i++)
+	{
+		Contact &contact = contacts[i];
+		uint64_t key = ((uint64_t)contact.a << 32) | (uint32_t)contact.b;
+		contact.began = !std::binary_search(touching.begin(), touching.end(), key);
+		current.push_back(key);
+	}
+	touching.assign(current.begin(), current.end());
+
+	for (int i = 0; i < contacts.size(); i++)
+	{
+		Contact &contact = contacts[i];
+		BodyState &first = state.bodies[contact.a];
+		BodyState &second = state.bodies[contact.b];
+
+		if (!first.active || !second.active)
+			continue;
+
+		if (contact.began)
+			contact_count += 1;
+
+		switch (response)
+		{
+		case CollisionResponse::LOG:
+			if (contact.began)
+				std::cout << "contact: " << solarsystem.planets[contact.a]->name << " - " << solarsystem.planets[contact.b]->name << " at " << state.time << " s\n";
+			break;
+
+		case CollisionResponse::MERGE:
+		{
+			// the larger body absorbs the smaller one and keeps the combined volume
+			BodyState &larger = first.radius >= second.radius ? first : second;
+			BodyState &smaller = first.radius >= second.radius ? second : first;
+			larger.radius = std::cbrt(larger.radius * larger.radius * larger.radius + smaller.radius * smaller.radius * smaller.radius);
+			if (state.gravity)
+			{
+				float mass = larger.mass + smaller.mass;
+				if (mass > 0.0f)
+					larger.velocity = (larger.velocity * larger.mass + smaller.velocity * smaller.mass) / mass;
+				larger.mass = mass;
+			}
+			smaller.active = false;
+			break;
+		}
+
+		case CollisionResponse::BOUNCE:
+		{
+			glm::vec3 separation = second.position - first.position;
+			if (state.gravity)
+			{
+				// elastic exchange of momentum along the line between the centers
+				glm::vec3 normal = glm::normalize(separation);
+				float closing = glm::dot(second.velocity - first.velocity, normal);
+				float mass = first.mass + second.mass;
+				if (closing < 0.0f && mass > 0.0f)
+				{
+					first.velocity += normal * (2.0f * second.mass / mass * closing);
+					second.velocity -= normal * (2.0f * first.mass / mass * closing);
+				}
+				break;
+			}
+
+			// orbits are closed form, so a bounce sends both bodies back the way they came
+			glm::vec3 approach = (second.position - previous[contact.b]) - (first.position - previous[contact.a]);
+			if (glm::dot(separation, approach) < 0.0f)
+			{
+				first.orbit_speed = -first.orbit_speed;
+				second.orbit_speed = -second.orbit_speed;
+			}
+			break;
+		}
+		}
+	}
+}
+
+uint32_t Collisions::hashCell(glm::ivec3 cell)
+{
+	return ((uint32_t)cell.x * 73856093u) ^ ((uint32_t)cell.y * 19349663u) ^ ((uint32_t)cell.z * 83492791u);
+}
+
+glm::ivec3 Collisions::getCell(glm::vec3 point)
+{
+	return glm::ivec3(glm::floor(point / cell_size));
+}
+
+void Collisions::parseResponse(const std::string &name)
+{
+	enabled = true;
+	if (name == "log")
+		response = CollisionResponse::LOG;
+	else if (name == "merge")
+		response = CollisionResponse::MERGE;
+	else if (name == "bounce")
+		response = CollisionResponse::BOUNCE;
+	else if (name == "off")
+		enabled = false;
+	else
+		std::cout << "unknown collision response: " << name << "\n";
+}
\ No newline at end of file
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "state.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <cstdint>
+
+enum class CollisionResponse
+{
+	LOG,
+	MERGE,
+	BOUNCE
+};
+
+struct Contact
+{
+	int a = 0;
+	int b = 0;
+
+	// fraction of the step at which the spheres first touch, 0 when they already overlapped at its start
+	float time = 0.0f;
+	glm::vec3 point = glm::vec3(0.0f);
+	bool began = true;
+};
+
+struct CellEntry
+{
+	glm::ivec3 cell = glm::ivec3(0);
+	int body = 0;
+};
+
+class Collisions
+{
+public:
+	// off unless --collisions picks a response, logging every contact from the simulation thread is opt in
+	bool enabled = false;
+	CollisionResponse response = CollisionResponse::LOG;
+	int grain = 256;
+
+	// side length of a grid cell, recomputed every step from the mean swept extent so each body touches a few cells
+	float cell_size = 1.0f;
+
+	std::vector<glm::vec3> previous;
+	std::vector<glm::vec3> lower;
+	std::vector<glm::vec3> upper;
+
+	// entries are counting sorted by cell hash, bucket i spans offsets[i] to offsets[i + 1]
+	std::vector<int> entry_counts;
+	std::vector<int> entry_offsets;
+	std::vector<CellEntry> entries;
+	std::vector<CellEntry> sorted;
+	std::unique_ptr<std::atomic<int>[]> bucket_counts;
+	std::vector<int> bucket_offsets;
+	int bucket_count = 0;
+
+	// bodies spanning more than max_cells cells are tested against everything instead of filling the grid
+	int max_cells = 64;
+	std::vector<int> large;
+
+	std::vector<Contact> contacts;
+	std::vector<uint64_t> touching;
+	std::atomic<int> contact_count = 0;
+
+	void reset();
+	void detect(SimulationState &state, float delta_time);
+	void buildGrid(const SimulationState &state);
+	void findContacts(const SimulationState &state);
+	bool testPair(const SimulationState &state, int a, int b, Contact &contact);
+	void respond(SimulationState &state);
+	uint32_t hashCell(glm::ivec3 cell);
+	glm::ivec3 getCell(glm::vec3 point);
+	void parseResponse(const std::string &name);
+};
\ No newline at end of file
@@ -0,0 +1,187 @@
+#include "ephemeris.h"
+#include "planet.h"
+#include "global.h"
+#include "profiler.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+bool Ephemeris::load(const std::string &path, const std::vector<Planet *> &planets)
+{
+	if (!file.open(path))
+	{
+		std::cout << "failed to open ephemeris: " << path << "\n";
+		return false;
+	}
+
+	EphemerisHeader expected;
+	if (file.size >= sizeof(header))
+		memcpy(&header, file.data, sizeof(header));
+
+	// counts are checked against the file by division, a crafted header could make their product wrap
+	size_t names = (size_t)header.body_count * header.name_size;
+	size_t track_size = 3 * sizeof(double) * (size_t)header.coefficient_count;
+	if (file.size < sizeof(header) || memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0 || header.version != expected.version ||
+		header.header_size != sizeof(EphemerisHeader) || header.coefficient_count == 0 || header.body_count == 0 || header.segment_count == 0 || header.interval <= 0.0 ||
+		(header.header_size + names) % sizeof(double) != 0 || file.size < header.header_size + names ||
+		header.segment_count > (file.size - header.header_size - names) / track_size / header.body_count)
+	{
+		std::cout << "not a valid ephemeris: " << path << "\n";
+		file.close();
+		return false;
+	}
+
+	// tracks drive whichever bodies carry the same name, the rest keep their own motion
+	const char *name = (const char *)(file.data + header.header_size);
+	int matched = 0;
+	for (int i = 0; i < header.body_count; i++, name += header.name_size)
+	{
+		std::string track(name, strnlen(name, header.name_size));
+		for (int j = 0; j < planets.size(); j++)
+		{
+			if (planets[j]->name == track)
+			{
+				planets[j]->ephemeris_index = i;
+				matched += 1;
+			}
+		}
+	}
+
+	coefficients = (const double *)(file.data + header.header_size + names);
+	positions.resize(header.body_count);
+	recurrence.resize((size_t)header.body_count * 2);
+	std::cout << "loaded ephemeris: " << path << ", " << matched << " of " << header.body_count << " tracks matched, " << header.start << " to " << header.start + header.interval * header.segment_count << " s\n";
+	return true;
+}
+
+bool Ephemeris::isLoaded()
+{
+	return coefficients != nullptr;
+}
+
+void Ephemeris::evaluate(double time)
+{
+	PROFILE_SCOPE("Ephemeris::evaluate");
+
+	// segments are uniform, so finding one is a division however long the file runs. outside the span bodies hold still
+	double offset = (time - header.start) / header.interval;
+	int64_t segment = std::clamp((int64_t)std::floor(offset), (int64_t)0, (int64_t)header.segment_count - 1);
+	double x = std::clamp(2.0 * (offset - (double)segment) - 1.0, -1.0, 1.0);
+
+	const double *data = coefficients + (size_t)segment * 3 * header.coefficient_count * header.body_count;
+	jobs.parallelFor((int)header.body_count, grain, [&](int begin, int end)
+	{
+		evaluateRange(begin, end, data, x);
+	});
+}
+
+void Ephemeris::evaluateRange(int begin, int end, const double *segment, double x)
+{
+	int count = (int)header.body_count;
+	int last = (int)header.coefficient_count - 1;
+	double *first = recurrence.data();
+	double *second = recurrence.data() + count;
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		const double *axis_data = segment + (size_t)axis * header.coefficient_count * count;
+		std::fill(first + begin, first + end, 0.0);
+		std::fill(second + begin, second + end, 0.0);
+
+		// clenshaw from the highest coefficient down, every pass is one straight loop over the bodies
+		for (int k = last; k >= 1; k--)
+		{
+			const double *row = axis_data + (size_t)k * count;
+			for (int i = begin; i < end; i++)
+			{
+				double value = row[i] + 2.0 * x * first[i] - second[i];
+				second[i] = first[i];
+				first[i] = value;
+			}
+		}
+
+		const double *row = axis_data;
+		for (int i = begin; i < end; i++)
+			positions[i][axis] = (float)(row[i] + x * first[i] - second[i]);
+	}
+}
+
+bool Ephemeris::bake(const std::string &path, SimulationState &state, const std::vector<Planet *> &planets, double span, double interval, int coefficient_count, std::function<void(SimulationState &, float)> advance)
+{
+	PROFILE_SCOPE("Ephemeris::bake");
+
+	std::ofstream output(path, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+	if (!output)
+	{
+		std::cout << "failed to write ephemeris: " << path << "\n";
+		return false;
+	}
+
+	int count = (int)state.bodies.size();
+	EphemerisHeader header;
+	header.body_count = count;
+	header.coefficient_count = coefficient_count;
+	header.start = state.time;
+	header.interval = interval;
+	header.segment_count = (uint64_t)std::max(std::ceil(span / interval), 1.0);
+	output.write((const char *)&header, sizeof(header));
+
+	std::vector<char> names((size_t)count * header.name_size, 0);
+	for (int i = 0; i < count; i++)
+		memcpy(names.data() + (size_t)i * header.name_size, planets[i]->name.c_str(), std::min(planets[i]->name.size(), (size_t)header.name_size - 1));
+	output.write(names.data(), names.size());
+
+	// interpolation at the chebyshev nodes, which sit in decreasing order of x so they are visited back to front
+	int nodes = coefficient_count;
+	std::vector<glm::vec3> samples((size_t)nodes * count);
+	std::vector<double> segment((size_t)3 * coefficient_count * count);
+	for (uint64_t s = 0; s < header.segment_count; s++)
+	{
+		double segment_start = header.start + (double)s * interval;
+		for (int j = nodes - 1; j >= 0; j--)
+		{
+			double x = std::cos(3.14159265358979 * (j + 0.5) / nodes);
+			double time = segment_start + (x + 1.0) * 0.5 * interval;
+			advance(state, (float)(time - state.time));
+			state.time = time;
+			for (int i = 0; i < count; i++)
+				samples[(size_t)j * count + i] = state.bodies[i].position;
+		}
+
+		jobs.parallelFor(count, 1024, [&](int begin, int end)
+		{
+			for (int axis = 0; axis < 3; axis++)
+			{
+				for (int k = 0; k < coefficient_count; k++)
+				{
+					double *row = segment.data() + ((size_t)axis * coefficient_count + k) * count;
+					for (int i = begin; i < end; i++)
+					{
+						double sum = 0.0;
+						for (int j = 0; j < nodes; j++)
+							sum += samples[(size_t)j * count + i][axis] * std::cos(3.14159265358979 * k * (j + 0.5) / nodes);
+						row[i] = sum * (k == 0 ? 1.0 : 2.0) / nodes;
+					}
+				}
+			}
+		});
+		output.write((const char *)segment.data(), segment.size() * sizeof(double));
+	}
+
+	output.close();
+	if (!output)
+	{
+		std::cout << "failed to write ephemeris: " << path << "\n";
+		return false;
+	}
+
+	std::cout << "baked ephemeris: " << path << ", " << count << " bodies, " << header.segment_count << " segments\n";
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "state.h"
+#include "mapped_file.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <string>
+#include <functional>
+#include <cstdint>
+
+class Planet;
+
+// followed by body_count names, then per segment, per axis, per coefficient, one double for every body,
+// so a single coefficient of all bodies is contiguous and the evaluation runs across bodies
+#pragma pack(push, 1)
+struct EphemerisHeader
+{
+	char magic[4] = {'H', 'E', 'P', 'H'};
+	uint32_t version = 1;
+	uint32_t header_size = sizeof(EphemerisHeader);
+	uint32_t body_count = 0;
+	uint32_t coefficient_count = 0;
+	uint32_t name_size = 32;
+	double start = 0.0;
+	double interval = 1.0;
+	uint64_t segment_count = 0;
+};
+#pragma pack(pop)
+
+class Ephemeris
+{
+public:
+	int grain = 1024;
+
+	MappedFile file;
+	EphemerisHeader header;
+	const double *coefficients = nullptr;
+
+	// positions of every track at the last evaluated time, and the clenshaw recurrence terms per axis
+	std::vector<glm::vec3> positions;
+	std::vector<double> recurrence;
+
+	bool load(const std::string &path, const std::vector<Planet *> &planets);
+	bool isLoaded();
+	void evaluate(double time);
+	void evaluateRange(int begin, int end, const double *segment, double x);
+	static bool bake(const std::string &path, SimulationState &state, const std::vector<Planet *> &planets, double span, double interval, int coefficient_count, std::function<void(SimulationState &, float)> advance);
+};
\ No newline at end of file
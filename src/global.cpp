@@ -2,4 +2,19 @@
 
 Camera camera;
 Solarsystem solarsystem;
-UI ui;
\ No newline at end of file
+UI ui;
+Pacer pacer;
+Simulation simulation;
+Profiler profiler;
+GpuTimer gpu_timer;
+Stats stats;
+Recorder recorder;
+Jobs jobs;
+Capture capture;
+Trails trails;
+TextureManager textures;
+Skybox skybox;
+Lighting lighting;
+Snapshot snapshot;
+Stars stars;
+Terrain terrain;
\ No newline at end of file
@@ -3,7 +3,37 @@
 #include "camera.h"
 #include "solarsystem.h"
 #include "ui.h"
+#include "pacer.h"
+#include "simulation.h"
+#include "profiler.h"
+#include "gpu_timer.h"
+#include "stats.h"
+#include "recorder.h"
+#include "jobs.h"
+#include "capture.h"
+#include "trails.h"
+#include "textures.h"
+#include "skybox.h"
+#include "lighting.h"
+#include "snapshot.h"
+#include "stars.h"
+#include "terrain.h"
 
 extern Camera camera;
 extern Solarsystem solarsystem;
-extern UI ui;
\ No newline at end of file
+extern UI ui;
+extern Pacer pacer;
+extern Simulation simulation;
+extern Profiler profiler;
+extern GpuTimer gpu_timer;
+extern Stats stats;
+extern Recorder recorder;
+extern Jobs jobs;
+extern Capture capture;
+extern Trails trails;
+extern TextureManager textures;
+extern Skybox skybox;
+extern Lighting lighting;
+extern Snapshot snapshot;
+extern Stars stars;
+extern Terrain terrain;
\ No newline at end of file
@@ -0,0 +1,98 @@
+#include "gpu_timer.h"
+#include "global.h"
+
+#include <glad/glad.h>
+
+#include <cstdint>
+
+void GpuTimer::initialize()
+{
+	glGenQueries(latency * pass_count * 2, &queries[0][0][0]);
+	calibrate();
+
+#ifdef HELIOS_PROFILER
+	buffer = profiler.createBuffer("gpu");
+#endif
+}
+
+void GpuTimer::calibrate()
+{
+	GLint64 gpu_time = 0;
+	glGetInteger64v(GL_TIMESTAMP, &gpu_time);
+	clock_offset = (int64_t)gpu_time - (int64_t)Profiler::now();
+}
+
+void GpuTimer::beginFrame()
+{
+	frame += 1;
+	if (frame % calibration_interval == 0)
+		calibrate();
+
+	// the slot about to be reused was issued `latency` frames ago, its results are normally available by now
+	int slot = frame % latency;
+
+	for (int i = 0; i < pass_count; i++)
+	{
+		// a pass that did not run that frame took no time, one whose result is late keeps its last reading
+		if (!pending[slot][i])
+		{
+			pass_times[i] = 0.0f;
+			continue;
+		}
+		pending[slot][i] = false;
+
+		GLint available = 0;
+		glGetQueryObjectiv(queries[slot][i][1], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+			continue;
+
+		GLuint64 start = 0;
+		GLuint64 end = 0;
+		glGetQueryObjectui64v(queries[slot][i][0], GL_QUERY_RESULT, &start);
+		glGetQueryObjectui64v(queries[slot][i][1], GL_QUERY_RESULT, &end);
+
+		pass_times[i] = (float)(end - start) / 1000000.0f;
+
+		if (buffer)
+			buffer->record(getPassName((GpuPass)i), (uint64_t)((int64_t)start - clock_offset), (uint64_t)((int64_t)end - clock_offset));
+	}
+
+	// summed over every pass so the info page and the per pass breakdown always agree
+	frame_time = 0.0f;
+	for (int i = 0; i < pass_count; i++)
+		frame_time += pass_times[i];
+}
+
+void GpuTimer::begin(GpuPass pass)
+{
+	glQueryCounter(queries[frame % latency][(int)pass][0], GL_TIMESTAMP);
+}
+
+void GpuTimer::end(GpuPass pass)
+{
+	glQueryCounter(queries[frame % latency][(int)pass][1], GL_TIMESTAMP);
+	pending[frame % latency][(int)pass] = true;
+}
+
+const char *GpuTimer::getPassName(GpuPass pass)
+{
+	switch (pass)
+	{
+	case GpuPass::BODIES:
+		return "bodies";
+	case GpuPass::SKYBOX:
+		return "skybox";
+	case GpuPass::STARS:
+		return "stars";
+	case GpuPass::ORBITS:
+		return "orbits";
+	case GpuPass::TRAILS:
+		return "trails";
+	case GpuPass::AXES:
+		return "axes";
+	case GpuPass::UI:
+		return "ui";
+	default:
+		return "";
+	}
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "profiler.h"
+
+#include <glad/glad.h>
+
+#include <cstdint>
+
+enum class GpuPass
+{
+	BODIES,
+	SKYBOX,
+	STARS,
+	ORBITS,
+	TRAILS,
+	AXES,
+	UI,
+	COUNT
+};
+
+class GpuTimer
+{
+public:
+	// frames a query pair stays in flight before it is read back, so reading never waits on the gpu
+	static constexpr int latency = 4;
+	static constexpr int pass_count = (int)GpuPass::COUNT;
+
+	GLuint queries[latency][pass_count][2] = {};
+	bool pending[latency][pass_count] = {};
+	int frame = 0;
+
+	float pass_times[pass_count] = {};
+	float frame_time = 0.0f;
+
+	// gpu timestamp minus cpu timestamp in nanoseconds, recalibrated periodically against drift
+	int64_t clock_offset = 0;
+	int calibration_interval = 120;
+
+	ProfileBuffer *buffer = nullptr;
+
+	void initialize();
+	void calibrate();
+	void beginFrame();
+	void begin(GpuPass pass);
+	void end(GpuPass pass);
+	const char *getPassName(GpuPass pass);
+};
\ No newline at end of file
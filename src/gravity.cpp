@@ -0,0 +1,248 @@
+#include "gravity.h"
+#include "global.h"
+#include "profiler.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+void Gravity::toggle()
+{
+	toggle_requested.store(true, std::memory_order_release);
+}
+
+void Gravity::applyToggle(SimulationState &state)
+{
+	if (!toggle_requested.exchange(false, std::memory_order_acquire))
+		return;
+
+	if (state.gravity)
+		state.gravity = false;
+	else
+		enable(state, solarsystem.planets);
+}
+
+void Gravity::enable(SimulationState &state, const std::vector<Planet *> &planets)
+{
+	// start every body on a circular orbit around its anchor, anchors are listed before their satellites
+	glm::vec3 momentum = glm::vec3(0.0f);
+	float total_mass = 0.0f;
+	for (int i = 0; i < state.bodies.size(); i++)
+	{
+		BodyState &body = state.bodies[i];
+		body.mass = planets[i]->mass;
+		body.velocity = glm::vec3(0.0f);
+
+		Planet *anchor = planets[i]->orbit_anchor;
+		if (anchor)
+		{
+			const BodyState &center = state.bodies[anchor->id];
+			glm::vec3 offset = body.position - center.position;
+			float distance = glm::length(offset);
+			glm::vec3 tangent = glm::cross(planets[i]->orbit_axis, offset);
+			if (distance > 0.0f && glm::length(tangent) > 0.0f)
+			{
+				float speed = std::sqrt((center.mass + body.mass) / distance);
+				body.velocity = center.velocity + glm::normalize(tangent) * speed * (body.orbit_speed < 0.0f ? -1.0f : 1.0f);
+			}
+		}
+
+		if (body.active)
+		{
+			momentum += body.velocity * body.mass;
+			total_mass += body.mass;
+		}
+	}
+
+	// no net drift, the system stays around the origin instead of wandering off with the camera
+	if (total_mass > 0.0f)
+	{
+		for (int i = 0; i < state.bodies.size(); i++)
+			state.bodies[i].velocity -= momentum / total_mass;
+	}
+
+	state.gravity = true;
+}
+
+void Gravity::advance(SimulationState &state, float delta_time)
+{
+	// leapfrog is time symmetric, a negative time scale runs the same steps backwards
+	if (delta_time == 0.0f)
+		return;
+
+	PROFILE_SCOPE("Gravity::advance");
+
+	int count = (int)state.bodies.size();
+
+	// the previous step closed with forces on every body at these exact positions, unless a seek, a merge or a restore moved them
+	bool reuse = isClosed(state);
+	accelerations.resize(count);
+	levels.resize(count);
+	timescales.resize(count);
+
+	// all bodies are synchronized at the start of the step, levels are picked fresh and everyone opens with a half kick
+	active.clear();
+	for (int i = 0; i < count; i++)
+	{
+		if (state.bodies[i].active)
+			active.push_back(i);
+	}
+	int forces = 0;
+	if (!reuse)
+	{
+		computeAccelerations(state, active);
+		forces = (int)active.size();
+	}
+
+	for (int i = 0; i < count; i++)
+		levels[i] = state.bodies[i].active ? getLevel(timescales[i], delta_time) : 0;
+	if (!individual)
+	{
+		int level = 0;
+		for (int i = 0; i < count; i++)
+			level = std::max(level, levels[i]);
+		std::fill(levels.begin(), levels.end(), level);
+	}
+	for (int i = 0; i < active.size(); i++)
+	{
+		BodyState &body = state.bodies[active[i]];
+		body.velocity += accelerations[active[i]] * (delta_time / (float)(1 << levels[active[i]]) * 0.5f);
+	}
+
+	// ticks count the finest possible substep, so a body may move deeper at any point and still land on the grid
+	int64_t end = (int64_t)1 << max_level;
+	float tick_time = delta_time / (float)end;
+	int64_t tick = 0;
+	int deepest = 0;
+	while (tick < end)
+	{
+		int level = 0;
+		for (int i = 0; i < count; i++)
+		{
+			if (state.bodies[i].active)
+				level = std::max(level, levels[i]);
+		}
+		deepest = std::max(deepest, level);
+
+		int64_t next = tick + ((int64_t)1 << (max_level - level));
+		float drift = (float)(next - tick) * tick_time;
+		for (int i = 0; i < count; i++)
+		{
+			if (state.bodies[i].active)
+				state.bodies[i].position += state.bodies[i].velocity * drift;
+		}
+		tick = next;
+
+		// only bodies whose own step ends on this tick get new forces, everyone else keeps coasting
+		active.clear();
+		for (int i = 0; i < count; i++)
+		{
+			if (state.bodies[i].active && tick % ((int64_t)1 << (max_level - levels[i])) == 0)
+				active.push_back(i);
+		}
+		computeAccelerations(state, active);
+		forces += (int)active.size();
+
+		for (int i = 0; i < active.size(); i++)
+		{
+			int body = active[i];
+			state.bodies[body].velocity += accelerations[body] * (delta_time / (float)(1 << levels[body]) * 0.5f);
+			if (tick == end)
+				continue;
+
+			// regroup as orbits evolve, the next step opens with a half kick on the new level
+			if (individual)
+				levels[body] = alignLevel(getLevel(timescales[body], delta_time), levels[body], tick);
+			state.bodies[body].velocity += accelerations[body] * (delta_time / (float)(1 << levels[body]) * 0.5f);
+		}
+	}
+
+	close(state);
+	deepest_level = deepest;
+	force_count = forces;
+}
+
+void Gravity::computeAccelerations(const SimulationState &state, const std::vector<int> &bodies)
+{
+	// direct summation over every active body, parallel over the receivers
+	jobs.parallelFor((int)bodies.size(), 64, [&](int begin, int end)
+	{
+		for (int i = begin; i < end; i++)
+		{
+			int body = bodies[i];
+			glm::vec3 position = state.bodies[body].position;
+			float radius = state.bodies[body].radius;
+			float mass = state.bodies[body].mass;
+			glm::vec3 acceleration = glm::vec3(0.0f);
+			float shortest = INFINITY;
+			for (int j = 0; j < state.bodies.size(); j++)
+			{
+				const BodyState &other = state.bodies[j];
+				if (j == body || !other.active)
+					continue;
+
+				// bodies never get closer than touching, inside that the pull falls off like a uniform sphere's
+				glm::vec3 offset = other.position - position;
+				float contact = radius + other.radius;
+				float distance_squared = std::max(glm::dot(offset, offset), contact * contact);
+				float distance_cubed = distance_squared * std::sqrt(distance_squared);
+				if (other.mass > 0.0f)
+					acceleration += offset * (other.mass / distance_cubed);
+
+				// the same contact floor keeps an overlapping pair from pushing the level to max_level
+				if (mass + other.mass > 0.0f)
+					shortest = std::min(shortest, distance_cubed / (mass + other.mass));
+			}
+			accelerations[body] = acceleration;
+			timescales[body] = shortest;
+		}
+	});
+}
+
+int Gravity::getLevel(float timescale, float delta_time)
+{
+	if (timescale == INFINITY)
+		return 0;
+
+	float step = accuracy * std::sqrt(timescale);
+	int level = (int)std::ceil(std::log2(std::abs(delta_time) / std::max(step, 1e-30f)));
+	return std::clamp(level, 0, max_level);
+}
+
+bool Gravity::isClosed(const SimulationState &state)
+{
+	if (closed_positions.size() != state.bodies.size())
+		return false;
+
+	// a linear pass next to the quadratic one it saves, seeks, merges and restores all show up here
+	for (int i = 0; i < state.bodies.size(); i++)
+	{
+		const BodyState &body = state.bodies[i];
+		if (closed_positions[i] != glm::vec4(body.position, body.radius) || closed_masses[i] != (body.active ? body.mass : -1.0f))
+			return false;
+	}
+	return true;
+}
+
+void Gravity::close(const SimulationState &state)
+{
+	closed_positions.resize(state.bodies.size());
+	closed_masses.resize(state.bodies.size());
+	for (int i = 0; i < state.bodies.size(); i++)
+	{
+		const BodyState &body = state.bodies[i];
+		closed_positions[i] = glm::vec4(body.position, body.radius);
+		closed_masses[i] = body.active ? body.mass : -1.0f;
+	}
+}
+
+int Gravity::alignLevel(int level, int current, int64_t tick)
+{
+	// finer levels always divide the current one, a coarser step has to wait until its own boundary comes around
+	while (level < current && tick % ((int64_t)1 << (max_level - level)) != 0)
+		level += 1;
+	return level;
+}
\ No newline at end of file
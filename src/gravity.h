@@ -0,0 +1,49 @@
+#pragma once
+
+#include "state.h"
+#include "planet.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <atomic>
+#include <cstdint>
+
+// newtonian n-body integration with individual power-of-two timesteps, a body on level k steps delta_time / 2^k
+class Gravity
+{
+public:
+	// each step spans this fraction of the body's shortest dynamical time, sqrt(r^3 / (m_i + m_j)) with G = 1
+	float accuracy = 0.02f;
+	int max_level = 24;
+
+	// off puts every body on the deepest level, the single global step the blocks replace
+	bool individual = true;
+
+	// posted from the render side, applied by whichever side steps the simulation
+	std::atomic<bool> toggle_requested = false;
+	std::atomic<int> deepest_level = 0;
+	std::atomic<int> force_count = 0;
+
+	std::vector<glm::vec3> accelerations;
+	std::vector<int> levels;
+	std::vector<int> active;
+
+	// shortest dynamical time of each body, found in the same pass as its forces
+	std::vector<float> timescales;
+
+	// every body as the last step closed, xyz position and w radius, with the mass negative for inactive bodies.
+	// its forces are still good for the next opening kick as long as none of that changed
+	std::vector<glm::vec4> closed_positions;
+	std::vector<float> closed_masses;
+
+	void toggle();
+	void applyToggle(SimulationState &state);
+	void enable(SimulationState &state, const std::vector<Planet *> &planets);
+	void advance(SimulationState &state, float delta_time);
+	void computeAccelerations(const SimulationState &state, const std::vector<int> &bodies);
+	int getLevel(float timescale, float delta_time);
+	bool isClosed(const SimulationState &state);
+	void close(const SimulationState &state);
+	int alignLevel(int level, int current, int64_t tick);
+};
\ No newline at end of file
@@ -0,0 +1,98 @@
+#include "history.h"
+#include "profiler.h"
+
+#include <vector>
+#include <cmath>
+
+void History::reset(const SimulationState &state)
+{
+	checkpoints.clear();
+	bytes = 0;
+	thin_count = 0;
+	interval = base_interval;
+	insert(state, 0);
+}
+
+void History::setBaseInterval(double base)
+{
+	base_interval = base;
+	interval = std::ldexp(base, thin_count);
+}
+
+void History::truncate(double time)
+{
+	// whatever follows belongs to a timeline the simulation is no longer on, keep at least the first checkpoint
+	while (checkpoints.size() > 1 && checkpoints.back().time > time)
+	{
+		bytes -= getStateSize(checkpoints.back());
+		checkpoints.pop_back();
+	}
+}
+
+void History::record(const SimulationState &state)
+{
+	// time runs either way, only extend the covered span at whichever end the simulation is moving past
+	if (checkpoints.empty() || state.time >= checkpoints.back().time + interval)
+		insert(state, (int)checkpoints.size());
+	else if (state.time <= checkpoints.front().time - interval)
+		insert(state, 0);
+}
+
+void History::insert(const SimulationState &state, int index)
+{
+	PROFILE_SCOPE("History::insert");
+
+	size_t size = getStateSize(state);
+	while (bytes + size > budget && checkpoints.size() > 2)
+		thin();
+
+	checkpoints.insert(checkpoints.begin() + index, state);
+	bytes += size;
+}
+
+void History::thin()
+{
+	// drop every other checkpoint, keeping both ends, which halves memory and doubles the spacing
+	std::vector<SimulationState> kept;
+	size_t kept_bytes = 0;
+	for (int i = 0; i < checkpoints.size(); i++)
+	{
+		if (i % 2 == 0 || i == checkpoints.size() - 1)
+		{
+			kept_bytes += getStateSize(checkpoints[i]);
+			kept.push_back(std::move(checkpoints[i]));
+		}
+	}
+
+	checkpoints = std::move(kept);
+	bytes = kept_bytes;
+	thin_count += 1;
+	interval = std::ldexp(base_interval, thin_count);
+}
+
+int History::find(double time)
+{
+	// latest checkpoint at or before time, so seeking only ever integrates forward
+	int low = 0;
+	int high = (int)checkpoints.size() - 1;
+	int result = -1;
+	while (low <= high)
+	{
+		int middle = (low + high) / 2;
+		if (checkpoints[middle].time <= time)
+		{
+			result = middle;
+			low = middle + 1;
+		}
+		else
+		{
+			high = middle - 1;
+		}
+	}
+	return result;
+}
+
+size_t History::getStateSize(const SimulationState &state)
+{
+	return sizeof(SimulationState) + state.bodies.size() * sizeof(BodyState);
+}
\ No newline at end of file
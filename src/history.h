@@ -0,0 +1,31 @@
+#pragma once
+
+#include "state.h"
+
+#include <vector>
+#include <cstddef>
+
+class History
+{
+public:
+	size_t budget = (size_t)256 * 1024 * 1024;
+
+	// simulated seconds a seek can integrate within its time limit, set by the simulation from the measured step cost
+	double base_interval = 1.0;
+
+	// simulated seconds between checkpoints, the base doubled for every time the store was thinned to stay within budget
+	double interval = 1.0;
+	int thin_count = 0;
+
+	std::vector<SimulationState> checkpoints;
+	size_t bytes = 0;
+
+	void reset(const SimulationState &state);
+	void record(const SimulationState &state);
+	void setBaseInterval(double base);
+	void truncate(double time);
+	void insert(const SimulationState &state, int index);
+	void thin();
+	int find(double time);
+	size_t getStateSize(const SimulationState &state);
+};
\ No newline at end of file
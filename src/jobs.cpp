@@ -0,0 +1,164 @@
+#include "jobs.h"
+#include "profiler.h"
+#include "arena.h"
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+
+void Jobs::start(int count)
+{
+	if (count <= 0)
+		count = std::max((int)std::thread::hardware_concurrency() - 2, 1);
+
+	stopping = false;
+	for (int i = 0; i < count; i++)
+		workers.push_back(std::thread(&Jobs::run, this));
+}
+
+void Jobs::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	available.notify_all();
+
+	for (int i = 0; i < workers.size(); i++)
+		workers[i].join();
+	workers.clear();
+}
+
+void Jobs::run()
+{
+	PROFILE_THREAD("worker");
+
+	while (true)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			available.wait(lock, [this] { return stopping || queue_count > 0; });
+			if (queue_count == 0)
+				return;
+
+			job = std::move(queue[queue_head]);
+			queue_head = (queue_head + 1) % queue.size();
+			queue_count -= 1;
+			active += 1;
+		}
+
+		job();
+		job = nullptr;
+
+		// whatever the job left in this worker's arena is garbage now
+		frameArena().reset();
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			active -= 1;
+			if (active == 0 && queue_count == 0)
+				idle.notify_all();
+		}
+	}
+}
+
+void Jobs::submit(std::function<void()> job)
+{
+	// without workers, run inline so callers never deadlock waiting on a job nobody will pick up
+	if (workers.empty())
+	{
+		job();
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (queue_count == queue.size())
+		{
+			// unroll the ring into a bigger one, oldest job first
+			std::vector<std::function<void()>> grown(std::max(queue.size() * 2, (size_t)64));
+			for (size_t i = 0; i < queue_count; i++)
+				grown[i] = std::move(queue[(queue_head + i) % queue.size()]);
+			queue = std::move(grown);
+			queue_head = 0;
+		}
+		queue[(queue_head + queue_count) % queue.size()] = std::move(job);
+		queue_count += 1;
+	}
+	available.notify_one();
+}
+
+void Jobs::wait()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	idle.wait(lock, [this] { return active == 0 && queue_count == 0; });
+}
+
+void Jobs::parallelFor(int count, int grain, void (*invoke)(void *body, int begin, int end), void *body)
+{
+	int chunks = (count + grain - 1) / grain;
+	if (chunks <= 1 || workers.empty())
+	{
+		invoke(body, 0, count);
+		return;
+	}
+
+	// the calling thread takes chunks as well, so this also completes when every worker is busy elsewhere.
+	// helpers that only get scheduled after the loop finished find nothing left and exit, the last one out recycles the range
+	JobRange *range = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!free_ranges.empty())
+		{
+			range = free_ranges.back();
+			free_ranges.pop_back();
+		}
+	}
+	if (!range)
+		range = new JobRange;
+
+	int helpers = std::min((int)workers.size(), chunks - 1);
+	range->invoke = invoke;
+	range->body = body;
+	range->next = 0;
+	range->done = 0;
+	range->references = helpers + 1;
+	range->chunks = chunks;
+	range->grain = grain;
+	range->count = count;
+
+	for (int i = 0; i < helpers; i++)
+		submit([this, range]
+		{
+			runRange(range);
+			releaseRange(range);
+		});
+	runRange(range);
+
+	// the body lives on the caller's stack, so every chunk has to be done before returning
+	while (range->done.load(std::memory_order_acquire) < chunks)
+		std::this_thread::yield();
+	releaseRange(range);
+}
+
+void Jobs::runRange(JobRange *range)
+{
+	int chunk;
+	while ((chunk = range->next.fetch_add(1)) < range->chunks)
+	{
+		range->invoke(range->body, chunk * range->grain, std::min((chunk + 1) * range->grain, range->count));
+		range->done.fetch_add(1, std::memory_order_release);
+	}
+}
+
+void Jobs::releaseRange(JobRange *range)
+{
+	if (range->references.fetch_sub(1, std::memory_order_acq_rel) != 1)
+		return;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	free_ranges.push_back(range);
+}
\ No newline at end of file
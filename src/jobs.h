@@ -0,0 +1,58 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <type_traits>
+
+// progress of one parallelFor, pooled because helpers that only get scheduled after the loop finished still touch it
+struct JobRange
+{
+	void (*invoke)(void *body, int begin, int end) = nullptr;
+	void *body = nullptr;
+	std::atomic<int> next = 0;
+	std::atomic<int> done = 0;
+	std::atomic<int> references = 0;
+	int chunks = 0;
+	int grain = 0;
+	int count = 0;
+};
+
+class Jobs
+{
+public:
+	std::vector<std::thread> workers;
+
+	// ring buffer, only grows, so steady submitting never touches the heap
+	std::vector<std::function<void()>> queue;
+	size_t queue_head = 0;
+	size_t queue_count = 0;
+
+	std::vector<JobRange *> free_ranges;
+
+	std::mutex mutex;
+	std::condition_variable available;
+	std::condition_variable idle;
+	int active = 0;
+	bool stopping = false;
+
+	void start(int count = 0);
+	void stop();
+	void run();
+	void submit(std::function<void()> job);
+	void wait();
+
+	// the body is called in place rather than wrapped in a std::function, which would allocate for larger captures
+	template<typename Body>
+	void parallelFor(int count, int grain, Body &&body)
+	{
+		parallelFor(count, grain, [](void *body, int begin, int end) { (*(std::remove_reference_t<Body> *)body)(begin, end); }, (void *)&body);
+	}
+	void parallelFor(int count, int grain, void (*invoke)(void *body, int begin, int end), void *body);
+
+	void runRange(JobRange *range);
+	void releaseRange(JobRange *range);
+};
\ No newline at end of file
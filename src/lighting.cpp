@@ -0,0 +1,196 @@
+#include "lighting.h"
+#include "global.h"
+#include "profiler.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <algorithm>
+#include <utility>
+
+void Lighting::initialize()
+{
+	glGenBuffers(1, &buffer);
+}
+
+void Lighting::update()
+{
+	PROFILE_SCOPE("Lighting::update");
+
+	std::vector<Planet *> &planets = solarsystem.planets;
+
+	emitters.clear();
+	for (int i = 0; i < planets.size(); i++)
+	{
+		if (planets[i]->emitter && planets[i]->visible)
+			emitters.push_back(i);
+	}
+
+	lights.resize(emitters.size());
+	ambient = glm::vec3(0.0f);
+	bool rebuild = bvh.spheres.size() != emitters.size();
+	bvh.spheres.resize(emitters.size());
+	for (int i = 0; i < emitters.size(); i++)
+	{
+		Planet *planet = planets[emitters[i]];
+		lights[i].position = glm::vec4(planet->position, planet->light.range);
+		lights[i].color = glm::vec4(planet->light.color, planet->radius);
+		lights[i].diffuse = glm::vec4(planet->light.diffuse, 0.0f);
+		lights[i].specular = glm::vec4(planet->light.specular, 0.0f);
+		bvh.spheres[i] = glm::vec4(planet->position, planet->light.range);
+		ambient = glm::max(ambient, planet->light.ambient * planet->light.color);
+	}
+
+	if (rebuild)
+		bvh.build();
+	else
+		bvh.refit();
+
+	updateGroups();
+
+	// per body, only the lights whose range reaches it, strongest first, at most max_body_lights of them
+	jobs.parallelFor((int)planets.size(), grain, [&](int begin, int end)
+	{
+		FrameVector<int> candidates;
+		for (int i = begin; i < end; i++)
+		{
+			cullLights(i, candidates);
+			findOccluders(i);
+		}
+	});
+
+	size_t size = lights.size() * sizeof(GpuLight);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+	if (size > buffer_size)
+	{
+		buffer_size = std::max(size, buffer_size * 2);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, buffer_size, nullptr, GL_DYNAMIC_DRAW);
+	}
+	if (size > 0)
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, size, lights.data());
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void Lighting::updateGroups()
+{
+	std::vector<Planet *> &planets = solarsystem.planets;
+
+	// the root is the last anchor that is not itself an emitter, so a planet and its moons share one group
+	roots.resize(planets.size());
+	groups.resize(planets.size());
+	for (int i = 0; i < planets.size(); i++)
+	{
+		groups[i].clear();
+		Planet *root = planets[i];
+		while (root->orbit_anchor != nullptr && !root->orbit_anchor->emitter)
+			root = root->orbit_anchor;
+		roots[i] = root->id;
+	}
+
+	for (int i = 0; i < planets.size(); i++)
+	{
+		if (!planets[i]->emitter && planets[i]->visible)
+			groups[roots[i]].push_back(i);
+	}
+}
+
+void Lighting::cullLights(int body, FrameVector<int> &candidates)
+{
+	Planet *planet = solarsystem.planets[body];
+	planet->light_count = 0;
+	if (planet->emitter || !planet->visible)
+		return;
+
+	candidates.clear();
+	bvh.overlap(glm::vec4(planet->position, planet->radius), candidates);
+
+	std::pair<float, int> ranked[max_body_lights];
+	int count = 0;
+	for (int i = 0; i < candidates.size(); i++)
+	{
+		const GpuLight &light = lights[candidates[i]];
+		float falloff = getFalloff(glm::length(glm::vec3(light.position) - planet->position), light.position.w);
+		float strength = falloff * glm::dot(glm::vec3(light.diffuse), glm::vec3(light.color));
+		if (strength <= 0.0f)
+			continue;
+
+		// insertion into a short sorted list, weakest dropped once it is full
+		int slot = std::min(count, max_body_lights - 1);
+		if (count == max_body_lights && strength <= ranked[slot].first)
+			continue;
+		while (slot > 0 && ranked[slot - 1].first < strength)
+		{
+			ranked[slot] = ranked[slot - 1];
+			slot -= 1;
+		}
+		ranked[slot] = std::make_pair(strength, candidates[i]);
+		count = std::min(count + 1, max_body_lights);
+	}
+
+	for (int i = 0; i < count; i++)
+		planet->light_indices[i] = ranked[i].second;
+	planet->light_count = count;
+}
+
+void Lighting::findOccluders(int body)
+{
+	Planet *planet = solarsystem.planets[body];
+	planet->occluder_count = 0;
+	if (planet->light_count == 0)
+		return;
+
+	glm::vec4 receiver = glm::vec4(planet->position, planet->radius);
+	const std::vector<int> &group = groups[roots[body]];
+	for (int i = 0; i < group.size() && planet->occluder_count < max_body_occluders; i++)
+	{
+		if (group[i] == body)
+			continue;
+
+		Planet *other = solarsystem.planets[group[i]];
+		glm::vec4 occluder = glm::vec4(other->position, other->radius);
+		for (int j = 0; j < planet->light_count; j++)
+		{
+			if (castsShadow(lights[planet->light_indices[j]], receiver, occluder))
+			{
+				planet->occluders[planet->occluder_count++] = occluder;
+				break;
+			}
+		}
+	}
+}
+
+bool Lighting::castsShadow(const GpuLight &light, glm::vec4 receiver, glm::vec4 occluder)
+{
+	// every ray from the light sphere to the receiver sphere stays inside the hull of both,
+	// whose radius grows linearly along the axis between them
+	glm::vec3 axis = glm::vec3(receiver) - glm::vec3(light.position);
+	float length = glm::length(axis);
+	if (length <= 0.0f)
+		return false;
+	axis /= length;
+
+	glm::vec3 offset = glm::vec3(occluder) - glm::vec3(light.position);
+	float along = glm::dot(offset, axis);
+	if (along <= 0.0f || along - occluder.w >= length)
+		return false;
+
+	float t = glm::clamp(along / length, 0.0f, 1.0f);
+	float hull = light.color.w + (receiver.w - light.color.w) * t;
+	float reach = hull + occluder.w;
+	glm::vec3 across = offset - axis * along;
+	return glm::dot(across, across) < reach * reach;
+}
+
+void Lighting::bind()
+{
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, buffer);
+}
+
+float Lighting::getFalloff(float distance, float range)
+{
+	// smooth window to zero at the range, the same curve the body shader applies
+	float ratio = distance / range;
+	float window = glm::clamp(1.0f - ratio * ratio * ratio * ratio, 0.0f, 1.0f);
+	return window * window;
+}
\ No newline at end of file
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "bvh.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// std430 layout, every vec3 padded out to a vec4
+struct GpuLight
+{
+	glm::vec4 position = glm::vec4(0.0f);
+	// w is the radius of the emitting body, for soft shadow edges
+	glm::vec4 color = glm::vec4(1.0f);
+	glm::vec4 diffuse = glm::vec4(0.0f);
+	glm::vec4 specular = glm::vec4(0.0f);
+};
+
+class Lighting
+{
+public:
+	static constexpr int max_body_lights = 8;
+	static constexpr int max_body_occluders = 4;
+	int grain = 256;
+
+	// planet index of every light, and the spheres their range covers
+	std::vector<int> emitters;
+	std::vector<GpuLight> lights;
+	Bvh bvh;
+
+	// applied once to every body, the brightest emitter's so it depends neither on range nor on the number of lights
+	glm::vec3 ambient = glm::vec3(0.0f);
+
+	// bodies grouped by the top of their anchor chain, only bodies of one group can eclipse each other
+	std::vector<int> roots;
+	std::vector<std::vector<int>> groups;
+
+	GLuint buffer = 0;
+	size_t buffer_size = 0;
+
+	void initialize();
+	void update();
+	void updateGroups();
+	void cullLights(int body, FrameVector<int> &candidates);
+	void findOccluders(int body);
+	bool castsShadow(const GpuLight &light, glm::vec4 receiver, glm::vec4 occluder);
+	void bind();
+	float getFalloff(float distance, float range);
+};
\ No newline at end of file
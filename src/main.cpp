@@ -3,6 +3,8 @@
 #include "solarsystem.h"
 #include "ui.h"
 #include "global.h"
+#include "offscreen.h"
+#include "arena.h"
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
@@ -12,9 +14,9 @@
 
 #include <string>
 #include <iostream>
-#include <iomanip>
 #include <fstream>
 #include <vector>
+#include <chrono>
 
 void processInputState(GLFWwindow *window, float delta_time);
 void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods);
@@ -24,27 +26,184 @@ void mouse_scroll_callback(GLFWwindow *window, double xoffset, double yoffset);
 void framebuffer_size_callback(GLFWwindow *window, int width, int height);
 void APIENTRY debug_callback(GLenum source, GLenum type, unsigned int id, GLenum severity, GLsizei length, const char *message, const void *userParam);
 
-int main()
+int main(int argc, char **argv)
 {
-    glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-    glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, true);
-
-    GLFWwindow *window = glfwCreateWindow(1920, 1080, "helios", NULL, NULL);
-    glfwSetWindowPos(window, 100, 100);
-    glfwMakeContextCurrent(window);
-    gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
-    ui.window = window;
+    bool write_trace = false;
+    bool headless = false;
+    bool offscreen_enabled = false;
+    int width = 1920;
+    int height = 1080;
+    int frame_limit = 0;
+    float fixed_delta_time = 0.0f;
+    std::string record_path = "";
+    std::string replay_path = "";
+    std::string snapshot_path = "";
+    std::string save_snapshot_path = "";
+    std::string ephemeris_path = "";
+    std::string bake_path = "";
+    double bake_span = 600.0;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--trace" && i + 1 < argc)
+        {
+            write_trace = true;
+            profiler.trace_path = argv[++i];
+        }
+        else if (arg == "--record" && i + 1 < argc)
+        {
+            record_path = argv[++i];
+        }
+        else if (arg == "--replay" && i + 1 < argc)
+        {
+            replay_path = argv[++i];
+        }
+        else if (arg == "--replay-delta" && i + 1 < argc)
+        {
+            recorder.delta_time = std::stof(argv[++i]);
+        }
+        else if (arg == "--replay-stats" && i + 1 < argc)
+        {
+            recorder.stats_path = argv[++i];
+        }
+        else if (arg == "--headless")
+        {
+            headless = true;
+        }
+        else if (arg == "--offscreen")
+        {
+            offscreen_enabled = true;
+        }
+        else if (arg == "--resolution" && i + 1 < argc)
+        {
+            std::string resolution = argv[++i];
+            width = std::stoi(resolution.substr(0, resolution.find('x')));
+            height = std::stoi(resolution.substr(resolution.find('x') + 1));
+        }
+        else if (arg == "--frames" && i + 1 < argc)
+        {
+            frame_limit = std::stoi(argv[++i]);
+        }
+        else if (arg == "--fixed-delta" && i + 1 < argc)
+        {
+            fixed_delta_time = std::stof(argv[++i]);
+        }
+        else if (arg == "--capture" && i + 1 < argc)
+        {
+            capture.enabled = true;
+            capture.path = argv[++i];
+        }
+        else if (arg == "--capture-format" && i + 1 < argc)
+        {
+            Capture::parseFormat(argv[++i], capture.format);
+        }
+        else if (arg == "--capture-fps" && i + 1 < argc)
+        {
+            capture.fps = std::stof(argv[++i]);
+        }
+        else if (arg == "--texture-budget" && i + 1 < argc)
+        {
+            textures.budget = (size_t)std::stoul(argv[++i]) * 1024 * 1024;
+        }
+        else if (arg == "--collisions" && i + 1 < argc)
+        {
+            simulation.collisions.parseResponse(argv[++i]);
+        }
+        else if (arg == "--gravity")
+        {
+            simulation.gravity.toggle();
+        }
+        else if (arg == "--snapshot" && i + 1 < argc)
+        {
+            snapshot_path = argv[++i];
+            snapshot.path = snapshot_path;
+        }
+        else if (arg == "--save-snapshot" && i + 1 < argc)
+        {
+            save_snapshot_path = argv[++i];
+        }
+        else if (arg == "--ephemeris" && i + 1 < argc)
+        {
+            ephemeris_path = argv[++i];
+        }
+        else if (arg == "--bake-ephemeris" && i + 1 < argc)
+        {
+            bake_path = argv[++i];
+        }
+        else if (arg == "--bake-span" && i + 1 < argc)
+        {
+            bake_span = std::stod(argv[++i]);
+        }
+        else if (arg == "--stars" && i + 1 < argc)
+        {
+            stars.catalog_path = argv[++i];
+        }
+    }
+
+    // a replay already fixes every input, recording it again would only write the same events back out
+    if (replay_path != "" && record_path != "")
+    {
+        std::cout << "--record is ignored while replaying " << replay_path << "\n";
+        record_path = "";
+    }
+
+    // captured sequences advance the simulation by exactly one frame interval per frame, however long rendering takes
+    if (capture.enabled)
+        fixed_delta_time = 1.0f / capture.fps;
+
+    // offscreen runs are for throughput tests and stills, they step a fixed delta and stop on their own
+    if (offscreen_enabled && fixed_delta_time == 0.0f)
+        fixed_delta_time = 1.0f / 60.0f;
+    if (offscreen_enabled && frame_limit == 0)
+        frame_limit = 600;
+
+    PROFILE_THREAD("main");
 
-    glViewport(0, 0, 1920, 1080);
+    jobs.start();
 
-    glfwSetKeyCallback(window, key_callback);
-    glfwSetMouseButtonCallback(window, mouse_button_callback);
-    glfwSetCursorPosCallback(window, mouse_cursor_callback);
-    glfwSetScrollCallback(window, mouse_scroll_callback);
-    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    GLFWwindow *window = nullptr;
+    Offscreen offscreen;
+
+    if (offscreen_enabled)
+    {
+        offscreen.width = width;
+        offscreen.height = height;
+        if (!offscreen.createContext())
+            return 1;
+        gladLoadGLLoader((GLADloadproc)Offscreen::getProcAddress);
+        offscreen.createFramebuffer();
+        offscreen.bind();
+    }
+    else
+    {
+        glfwInit();
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, true);
+        if (headless)
+            glfwWindowHint(GLFW_VISIBLE, false);
+
+        window = glfwCreateWindow(width, height, "helios", NULL, NULL);
+        glfwSetWindowPos(window, 100, 100);
+        glfwMakeContextCurrent(window);
+        gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+
+        // on high dpi screens the framebuffer holds more pixels than the window size asked for
+        glfwGetFramebufferSize(window, &width, &height);
+        glViewport(0, 0, width, height);
+
+        glfwSetKeyCallback(window, key_callback);
+        glfwSetMouseButtonCallback(window, mouse_button_callback);
+        glfwSetCursorPosCallback(window, mouse_cursor_callback);
+        glfwSetScrollCallback(window, mouse_scroll_callback);
+        glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    }
+    ui.window = window;
+    pacer.window = window;
+    camera.resolution = glm::vec2((float)width, (float)height);
+    ui.updateProjection();
 
     glEnable(GL_DEPTH_TEST);
     // glEnable(GL_CULL_FACE);
@@ -53,83 +212,220 @@ int main()
     glDebugMessageCallback(debug_callback, nullptr);
     glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr, GL_TRUE);
     glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-    glfwSwapInterval(0);
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     glLineWidth(1.0f);
     glPointSize(1.0f);
 
-    float current_frame = 0.0f;
-    float last_frame = 0.0f;
     float delta_time = 0.0f;
 
+    // offscreen and replayed runs must render the same pixels every time, so nothing may pop in late
+    textures.asynchronous = !offscreen_enabled && !capture.enabled && replay_path == "";
+    textures.initialize();
+    // the catalog replaces the sky texture, which is then never loaded
+    stars.initialize();
+    if (stars.enabled)
+        skybox.enabled = false;
+    else
+        skybox.initialize();
+    lighting.initialize();
+    terrain.asynchronous = textures.asynchronous;
+    terrain.initialize();
     solarsystem.initializePlanets();
     solarsystem.generatePlanets();
+    if (ephemeris_path != "")
+        solarsystem.ephemeris.load(ephemeris_path, solarsystem.planets);
+
+    recorder.window = window;
+    recorder.key_callback = key_callback;
+    recorder.mouse_button_callback = mouse_button_callback;
+    recorder.mouse_cursor_callback = mouse_cursor_callback;
+    recorder.mouse_scroll_callback = mouse_scroll_callback;
+    if (replay_path != "" && recorder.startReplay(replay_path))
+    {
+        simulation.threaded = false;
+        pacer.mode = PacingMode::UNCAPPED;
+    }
+    else
+    {
+        if (fixed_delta_time > 0.0f)
+            simulation.threaded = false;
+        if (record_path != "")
+            recorder.startRecording(record_path);
+    }
+    if (offscreen_enabled)
+        pacer.mode = PacingMode::UNCAPPED;
+
+    simulation.initialize();
+    if (bake_path != "")
+    {
+        // samples a copy of the starting state, in gravity mode if that was asked for, the live run is unaffected
+        SimulationState baked = simulation.state;
+        if (simulation.gravity.toggle_requested)
+            simulation.gravity.enable(baked, solarsystem.planets);
+        Ephemeris::bake(bake_path, baked, solarsystem.planets, bake_span, 1.0, 12, [](SimulationState &state, float delta_time)
+        {
+            if (state.gravity)
+                simulation.gravity.advance(state, delta_time);
+            solarsystem.updatePlanets(state, delta_time);
+        });
+    }
+    if (snapshot_path != "")
+    {
+        SimulationState loaded = simulation.state;
+        if (snapshot.load(snapshot_path, loaded))
+            simulation.restore(loaded);
+    }
+    simulation.start();
 
     camera.offset = glm::vec3(-40.0f, 0.0f, 0.0f);
-    camera.anchor = solarsystem.planets[1];
+    camera.anchor = solarsystem.planets[0];
 
     ui.initializePages();
 
-    while (!glfwWindowShouldClose(window))
+    pacer.initialize();
+    gpu_timer.initialize();
+    trails.initialize((int)solarsystem.planets.size());
+    if (capture.enabled)
+        capture.initialize(width, height);
+
+    int frame = 0;
+    std::chrono::steady_clock::time_point run_start = std::chrono::steady_clock::now();
+
+    while (!(window && glfwWindowShouldClose(window)) && !recorder.isFinished() && !(frame_limit && frame >= frame_limit))
     {
-        if ((float)glfwGetTime() - last_frame < 1.0f / 120.0f)
-            continue;
+        delta_time = pacer.waitFrame();
+        frame += 1;
 
-        current_frame = (float)glfwGetTime();
-        delta_time = current_frame - last_frame;
-        last_frame = current_frame;
+        PROFILE_SCOPE("frame");
+        stats.beginFrame(delta_time);
+        gpu_timer.beginFrame();
 
-        std::cout << std::fixed;
-        std::cout << std::setprecision(4);
-        std::cout << "delta: " << delta_time << ", fps: " << 1.0f / delta_time << ", time: " << (float)glfwGetTime() << "\n";
+        if (recorder.isReplaying())
+        {
+            recorder.replayFrame(delta_time);
+            delta_time = recorder.delta_time;
+        }
+        else if (fixed_delta_time > 0.0f)
+        {
+            delta_time = fixed_delta_time;
+        }
+        recorder.advance(delta_time);
 
-        glClearColor(0.5f, 0.5f, 0.5f, 1.0f);
+        // point stars only cover their sprites, the space between them has to be black
+        if (stars.enabled)
+            glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+        else
+            glClearColor(0.5f, 0.5f, 0.5f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        processInputState(window, delta_time);
+        stats.beginSection(Section::UPDATE);
+        {
+            PROFILE_SCOPE("input");
+            processInputState(window, delta_time);
+        }
 
-        solarsystem.updatePlanets(delta_time);
+        {
+            PROFILE_SCOPE("interpolate");
+            if (!simulation.threaded)
+                simulation.advance(delta_time);
+            simulation.interpolate();
+            solarsystem.updateBounds();
+            lighting.update();
+        }
+        trails.update(simulation.current.time);
 
         camera.updatePosition();
+        camera.near_plane = terrain.getNearPlane(0.01f, 0.000001f);
         camera.updateViewMatrix();
         camera.updateProjectionMatrix();
+        terrain.update();
+        stats.endSection(Section::UPDATE);
 
+        stats.beginSection(Section::DRAW);
         solarsystem.drawPlanets();
+        stats.endSection(Section::DRAW);
 
+        stats.beginSection(Section::UI);
         ui.updatePage(ui.pages[ui.current_page]);
         glDisable(GL_DEPTH_TEST);
+        gpu_timer.begin(GpuPass::UI);
         ui.drawPage(ui.pages[ui.current_page]);
+        gpu_timer.end(GpuPass::UI);
         glEnable(GL_DEPTH_TEST);
+        stats.endSection(Section::UI);
+
+        if (window)
+        {
+            int framebuffer_width, framebuffer_height;
+            glfwGetFramebufferSize(window, &framebuffer_width, &framebuffer_height);
+            capture.captureFrame(framebuffer_width, framebuffer_height);
+        }
+        else
+            capture.captureFrame(offscreen.width, offscreen.height);
+        textures.update();
 
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        if (window)
+        {
+            PROFILE_SCOPE("swap");
+            glfwSwapBuffers(window);
+            glfwPollEvents();
+        }
+        else
+        {
+            glFlush();
+        }
+
+        // everything allocated from the frame arena this frame is dead by now
+        frameArena().reset();
+    }
+
+    if (offscreen_enabled)
+    {
+        glFinish();
+        float elapsed = std::chrono::duration<float>(std::chrono::steady_clock::now() - run_start).count();
+        std::cout << "rendered " << frame << " frames at " << width << "x" << height << " in " << elapsed << " s, " << frame / elapsed << " fps\n";
     }
 
-    glfwTerminate();
+    simulation.stop();
+    if (save_snapshot_path != "" && snapshot.write(simulation.state, save_snapshot_path))
+        std::cout << "saved snapshot: " << save_snapshot_path << "\n";
+    recorder.stop();
+    capture.finish();
+    jobs.stop();
+
+    if (write_trace)
+        profiler.writeTrace(profiler.trace_path);
+
+    if (offscreen_enabled)
+        offscreen.destroy();
+    else
+        glfwTerminate();
     return 0;
 }
 
+// held keys tracked from key events rather than polled, so replays see exactly what was recorded
+bool key_states[GLFW_KEY_LAST + 1] = {};
+
 void processInputState(GLFWwindow *window, float delta_time)
 {
-    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+    if (key_states[GLFW_KEY_ESCAPE] && window)
     {
         glfwSetWindowShouldClose(window, true);
     }
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+    if (key_states[GLFW_KEY_W])
     {
         camera.applyMovement(Movement::FRONT, delta_time);
     }
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+    if (key_states[GLFW_KEY_S])
     {
         camera.applyMovement(Movement::BACK, delta_time);
     }
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+    if (key_states[GLFW_KEY_A])
     {
         camera.applyMovement(Movement::LEFT, delta_time);
     }
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+    if (key_states[GLFW_KEY_D])
     {
         camera.applyMovement(Movement::RIGHT, delta_time);
     }
@@ -139,6 +435,13 @@ int render_mode = 0;
 
 void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods)
 {
+    if (!recorder.acceptsInput())
+        return;
+    recorder.recordKey(key, action, mods);
+
+    if (key >= 0 && key <= GLFW_KEY_LAST && action != GLFW_REPEAT)
+        key_states[key] = action == GLFW_PRESS;
+
     if (key == GLFW_KEY_TAB && action == GLFW_PRESS)
     {
         render_mode = (render_mode + 1) % 3;
@@ -176,33 +479,41 @@ void key_callback(GLFWwindow *window, int key, int scancode, int action, int mod
 
     if (key == GLFW_KEY_LEFT && action == GLFW_PRESS)
     {
-        if (solarsystem.time_scale < 0.0f)
-            solarsystem.time_scale *= 2.0f;
+        float time_scale = solarsystem.time_scale;
+        if (time_scale < 0.0f)
+            time_scale *= 2.0f;
         else
-            solarsystem.time_scale *= 0.5f;
+            time_scale *= 0.5f;
 
-        if (abs(solarsystem.time_scale) < 1.0f / pow(2.0f, 6))
-            solarsystem.time_scale *= -2.0f;
+        if (abs(time_scale) < 1.0f / pow(2.0f, 6))
+            time_scale *= -2.0f;
+        solarsystem.time_scale = time_scale;
+        recorder.recordControls();
     }
     if (key == GLFW_KEY_RIGHT && action == GLFW_PRESS)
     {
-        if (solarsystem.time_scale < 0.0f)
-            solarsystem.time_scale *= 0.5f;
+        float time_scale = solarsystem.time_scale;
+        if (time_scale < 0.0f)
+            time_scale *= 0.5f;
         else
-            solarsystem.time_scale *= 2.0f;
+            time_scale *= 2.0f;
 
-        if (abs(solarsystem.time_scale) < 1.0f / pow(2.0f, 6))
-            solarsystem.time_scale *= -2.0f;
+        if (abs(time_scale) < 1.0f / pow(2.0f, 6))
+            time_scale *= -2.0f;
+        solarsystem.time_scale = time_scale;
+        recorder.recordControls();
     }
 
     if (key == GLFW_KEY_SPACE && action == GLFW_PRESS)
     {
         solarsystem.paused = !solarsystem.paused;
+        recorder.recordControls();
     }
 
+    // 1-9 select the first nine bodies and 0 the tenth, in keyboard order
     for (int i = 0; i < 10 && i < solarsystem.planets.size(); i++)
     {
-        if (key == GLFW_KEY_0 + i && action == GLFW_PRESS)
+        if (key == GLFW_KEY_0 + (i + 1) % 10 && action == GLFW_PRESS)
         {
             camera.anchor = solarsystem.planets[i];
             // camera.offset = glm::normalize(camera.offset) * solarsystem.planets[i]->radius * 8.0f;
@@ -225,18 +536,82 @@ void key_callback(GLFWwindow *window, int key, int scancode, int action, int mod
     {
         ui.enabled = !ui.enabled;
     }
-}
 
-void mouse_button_callback(GLFWwindow *window, int button, int action, int mods)
-{
+    if (key == GLFW_KEY_V && action == GLFW_PRESS)
+    {
+        pacer.nextMode();
+    }
+
+    if (key == GLFW_KEY_T && action == GLFW_PRESS)
+    {
+        trails.enabled = !trails.enabled;
+    }
+
+    if (key == GLFW_KEY_G && action == GLFW_PRESS)
+    {
+        simulation.gravity.toggle();
+    }
+
+    if (key == GLFW_KEY_F5 && action == GLFW_PRESS)
+    {
+        snapshot.save(simulation.current);
+    }
+
+    if (key == GLFW_KEY_F9 && action == GLFW_PRESS)
+    {
+        SimulationState loaded = simulation.current;
+        if (snapshot.load(snapshot.path, loaded))
+            simulation.restore(loaded);
+    }
+
+    if (key == GLFW_KEY_LEFT_BRACKET && action == GLFW_PRESS)
+    {
+        simulation.seek(simulation.current.time - 10.0);
+    }
+
+    if (key == GLFW_KEY_RIGHT_BRACKET && action == GLFW_PRESS)
+    {
+        simulation.seek(simulation.current.time + 10.0);
+    }
+
+    if (key == GLFW_KEY_P && action == GLFW_PRESS)
+    {
+        profiler.writeTrace(profiler.trace_path);
+    }
 }
 
 bool first_mouse = true;
 float last_x = 0.0f;
 float last_y = 0.0f;
 
+void mouse_button_callback(GLFWwindow *window, int button, int action, int mods)
+{
+    if (!recorder.acceptsInput())
+        return;
+    recorder.recordButton(button, action, mods);
+
+    if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS)
+    {
+        // with the cursor captured the crosshair is the screen center, otherwise pick under the cursor
+        glm::vec2 screen = camera.resolution * 0.5f;
+        if (ui.pages[ui.current_page]->cursor_enabled)
+            screen = glm::vec2(last_x, last_y);
+
+        glm::vec3 origin;
+        glm::vec3 direction;
+        camera.getRay(screen, origin, direction);
+        Planet *planet = solarsystem.pickPlanet(origin, direction);
+        if (planet)
+            camera.anchor = planet;
+    }
+}
+
 void mouse_cursor_callback(GLFWwindow *window, double pos_x, double pos_y)
 {
+    if (!recorder.acceptsInput())
+        return;
+    recorder.recordCursor(pos_x, pos_y);
+
     float offset_x = (float)pos_x - last_x;
     float offset_y = last_y - (float)pos_y;
     last_x = (float)pos_x;
@@ -254,10 +629,21 @@ void mouse_cursor_callback(GLFWwindow *window, double pos_x, double pos_y)
 
 void mouse_scroll_callback(GLFWwindow *window, double offset_x, double offset_y)
 {
+    if (!recorder.acceptsInput())
+        return;
+    recorder.recordScroll(offset_x, offset_y);
+
+    camera.zoom((float)offset_y);
 }
 
 void framebuffer_size_callback(GLFWwindow *window, int width, int height)
 {
+    if (width == 0 || height == 0)
+        return;
+
+    glViewport(0, 0, width, height);
+    camera.resolution = glm::vec2((float)width, (float)height);
+    ui.updateProjection();
 }
 
 void APIENTRY debug_callback(GLenum source, GLenum type, unsigned int id, GLenum severity, GLsizei length, const char *message, const void *userParam)
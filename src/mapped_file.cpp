@@ -0,0 +1,97 @@
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <string>
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+bool MappedFile::open(const std::string &path)
+{
+	close();
+
+#ifdef _WIN32
+	file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		file = nullptr;
+		return false;
+	}
+
+	LARGE_INTEGER length;
+	if (!GetFileSizeEx(file, &length) || length.QuadPart == 0)
+	{
+		close();
+		return false;
+	}
+
+	mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mapping)
+	{
+		close();
+		return false;
+	}
+
+	data = (const uint8_t *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	size = (size_t)length.QuadPart;
+#else
+	int descriptor = ::open(path.c_str(), O_RDONLY);
+	if (descriptor < 0)
+		return false;
+
+	struct stat info;
+	if (fstat(descriptor, &info) != 0 || info.st_size == 0)
+	{
+		::close(descriptor);
+		return false;
+	}
+
+	// the mapping keeps its own reference, the descriptor isn't needed past this point
+	void *view = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+	::close(descriptor);
+	if (view == MAP_FAILED)
+		return false;
+
+	data = (const uint8_t *)view;
+	size = (size_t)info.st_size;
+#endif
+
+	if (!data)
+	{
+		close();
+		return false;
+	}
+	return true;
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+	if (data)
+		UnmapViewOfFile(data);
+	if (mapping)
+		CloseHandle(mapping);
+	if (file)
+		CloseHandle(file);
+	mapping = nullptr;
+	file = nullptr;
+#else
+	if (data)
+		munmap((void *)data, size);
+#endif
+
+	data = nullptr;
+	size = 0;
+}
\ No newline at end of file
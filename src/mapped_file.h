@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+// read only view of a whole file, pages are only faulted in as they are touched
+class MappedFile
+{
+public:
+	const uint8_t *data = nullptr;
+	size_t size = 0;
+
+	MappedFile() = default;
+	MappedFile(const MappedFile &) = delete;
+	MappedFile &operator=(const MappedFile &) = delete;
+	~MappedFile();
+
+	bool open(const std::string &path);
+	void close();
+
+#ifdef _WIN32
+	void *file = nullptr;
+	void *mapping = nullptr;
+#endif
+};
\ No newline at end of file
@@ -0,0 +1,121 @@
+#include "offscreen.h"
+
+#include <glad/glad.h>
+
+#ifdef HELIOS_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#include <iostream>
+
+void *Offscreen::getProcAddress(const char *name)
+{
+#ifdef HELIOS_EGL
+	return (void *)eglGetProcAddress(name);
+#else
+	return nullptr;
+#endif
+}
+
+bool Offscreen::createContext()
+{
+#ifdef HELIOS_EGL
+	// surfaceless platform needs neither a window system nor a pbuffer, falls back to the default display
+	EGLDisplay egl_display = EGL_NO_DISPLAY;
+	PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (get_platform_display)
+		egl_display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+	if (egl_display == EGL_NO_DISPLAY)
+		egl_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+	EGLint major, minor;
+	if (egl_display == EGL_NO_DISPLAY || !eglInitialize(egl_display, &major, &minor))
+	{
+		std::cout << "failed to initialize egl display\n";
+		return false;
+	}
+
+	eglBindAPI(EGL_OPENGL_API);
+
+	EGLint config_attributes[] = {
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_NONE
+	};
+	EGLConfig config = EGL_NO_CONFIG_KHR;
+	EGLint config_count = 0;
+	eglChooseConfig(egl_display, config_attributes, &config, 1, &config_count);
+	if (config_count == 0)
+		config = EGL_NO_CONFIG_KHR;
+
+	EGLint context_attributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 4,
+		EGL_CONTEXT_MINOR_VERSION, 5,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_CONTEXT_OPENGL_DEBUG, EGL_TRUE,
+		EGL_NONE
+	};
+	EGLContext egl_context = eglCreateContext(egl_display, config, EGL_NO_CONTEXT, context_attributes);
+	if (egl_context == EGL_NO_CONTEXT)
+	{
+		std::cout << "failed to create egl context: " << std::hex << eglGetError() << std::dec << "\n";
+		eglTerminate(egl_display);
+		return false;
+	}
+
+	if (!eglMakeCurrent(egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, egl_context))
+	{
+		std::cout << "failed to make egl context current\n";
+		eglDestroyContext(egl_display, egl_context);
+		eglTerminate(egl_display);
+		return false;
+	}
+
+	display = egl_display;
+	context = egl_context;
+	return true;
+#else
+	std::cout << "offscreen rendering needs egl, rebuild with egl available\n";
+	return false;
+#endif
+}
+
+void Offscreen::createFramebuffer()
+{
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+
+	glGenRenderbuffers(1, &color_renderbuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, color_renderbuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color_renderbuffer);
+
+	glGenRenderbuffers(1, &depth_renderbuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, depth_renderbuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depth_renderbuffer);
+
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		std::cout << "offscreen framebuffer incomplete\n";
+}
+
+void Offscreen::bind()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glViewport(0, 0, width, height);
+}
+
+void Offscreen::destroy()
+{
+	glDeleteFramebuffers(1, &framebuffer);
+	glDeleteRenderbuffers(1, &color_renderbuffer);
+	glDeleteRenderbuffers(1, &depth_renderbuffer);
+
+#ifdef HELIOS_EGL
+	eglMakeCurrent((EGLDisplay)display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	eglDestroyContext((EGLDisplay)display, (EGLContext)context);
+	eglTerminate((EGLDisplay)display);
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <glad/glad.h>
+
+class Offscreen
+{
+public:
+	int width = 1920;
+	int height = 1080;
+
+	void *display = nullptr;
+	void *context = nullptr;
+
+	GLuint framebuffer = 0;
+	GLuint color_renderbuffer = 0;
+	GLuint depth_renderbuffer = 0;
+
+	static void *getProcAddress(const char *name);
+
+	bool createContext();
+	void createFramebuffer();
+	void bind();
+	void destroy();
+};
\ No newline at end of file
@@ -0,0 +1,100 @@
+#include "pacer.h"
+#include "profiler.h"
+
+#include <GLFW/glfw3.h>
+
+#include <chrono>
+#include <thread>
+#include <string>
+#include <cmath>
+#include <algorithm>
+
+using Clock = std::chrono::steady_clock;
+
+void Pacer::initialize()
+{
+	setMode(mode);
+	last_frame = Clock::now();
+	deadline = last_frame;
+}
+
+void Pacer::setMode(PacingMode mode)
+{
+	this->mode = mode;
+
+	if (window)
+		glfwSwapInterval(mode == PacingMode::VSYNC ? 1 : 0);
+
+	deadline = Clock::now();
+	max_jitter = 0.0f;
+}
+
+void Pacer::nextMode()
+{
+	if (mode == PacingMode::VSYNC)
+		setMode(PacingMode::CAPPED);
+	else if (mode == PacingMode::CAPPED)
+		setMode(PacingMode::UNCAPPED);
+	else
+		setMode(PacingMode::VSYNC);
+}
+
+float Pacer::waitFrame()
+{
+	PROFILE_SCOPE("Pacer::waitFrame");
+
+	Clock::duration interval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / target_rate));
+
+	if (mode == PacingMode::CAPPED)
+	{
+		deadline += interval;
+
+		// fell more than a frame behind, resynchronize instead of rushing to catch up
+		if (Clock::now() > deadline + interval)
+			deadline = Clock::now();
+
+		waitUntil(deadline);
+	}
+
+	Clock::time_point now = Clock::now();
+	delta_time = std::chrono::duration<float>(now - last_frame).count();
+	last_frame = now;
+
+	float expected = 1.0f / target_rate;
+	if (mode != PacingMode::CAPPED)
+		expected = mean_interval;
+	mean_interval += (delta_time - mean_interval) * 0.05f;
+
+	float deviation = std::abs(delta_time - expected);
+	jitter += (deviation - jitter) * 0.05f;
+	max_jitter = std::max(max_jitter * 0.999f, deviation);
+
+	return delta_time;
+}
+
+void Pacer::waitUntil(Clock::time_point time)
+{
+	// sleep in one go until shortly before the deadline
+	Clock::time_point wake = time - std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(spin_margin));
+	if (Clock::now() < wake)
+	{
+		std::this_thread::sleep_until(wake);
+
+		// track how late the scheduler wakes us up and keep the spin margin just above that
+		double overshoot = std::chrono::duration<double>(Clock::now() - wake).count();
+		spin_margin = std::clamp(spin_margin + (overshoot * 1.5 + 0.0001 - spin_margin) * 0.1, 0.0002, 0.004);
+	}
+
+	// spin off the remainder, yielding so other threads on this core still make progress
+	while (Clock::now() < time)
+		std::this_thread::yield();
+}
+
+std::string Pacer::getModeName()
+{
+	if (mode == PacingMode::VSYNC)
+		return "vsync";
+	if (mode == PacingMode::CAPPED)
+		return "capped " + std::to_string((int)target_rate);
+	return "uncapped";
+}
\ No newline at end of file
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <GLFW/glfw3.h>
+
+#include <chrono>
+#include <string>
+
+enum class PacingMode
+{
+	VSYNC,
+	CAPPED,
+	UNCAPPED
+};
+
+class Pacer
+{
+public:
+	PacingMode mode = PacingMode::CAPPED;
+	GLFWwindow *window = nullptr;
+	float target_rate = 120.0f;
+
+	float delta_time = 0.0f;
+	float jitter = 0.0f;
+	float mean_interval = 0.0f;
+	float max_jitter = 0.0f;
+
+	// time before the deadline at which sleeping stops and spinning starts, adapted to the observed sleep overshoot
+	double spin_margin = 0.001;
+
+	std::chrono::steady_clock::time_point last_frame;
+	std::chrono::steady_clock::time_point deadline;
+
+	void initialize();
+	void setMode(PacingMode mode);
+	void nextMode();
+	float waitFrame();
+	void waitUntil(std::chrono::steady_clock::time_point time);
+	std::string getModeName();
+};
\ No newline at end of file
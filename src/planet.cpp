@@ -1,12 +1,12 @@
 #include "planet.h"
 #include "camera.h"
 #include "global.h"
+#include "profiler.h"
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
-#include <stb_image/stb_image.h>
 
 #include <vector>
 #include <string>
@@ -16,6 +16,8 @@
 
 void Planet::compileShader()
 {
+	PROFILE_SCOPE("Planet::compileShader");
+
 	// body
 	const char *body_vert_source;
 
@@ -121,41 +123,14 @@ void Planet::compileShader()
 
 void Planet::loadTextures()
 {
-	int width, height, channels;
-	unsigned char *data;
-
-	glGenTextures(1, &body_texture);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, body_texture);
-
-	stbi_set_flip_vertically_on_load(true);
-	data = stbi_load(texture_path.c_str(), &width, &height, &channels, 0);
-	if (data)
-	{
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
-	}
-	stbi_image_free(data);
-
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-	if (width < 256)
-	{
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_NEAREST);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	}
-	else
-	{
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	}
-
-	glBindTexture(GL_TEXTURE_2D, 0);
+	// only registered here, pixels are loaded on first use and may be evicted again while out of view
+	texture_id = textures.acquire(texture_path);
 }
 
 void Planet::generateMesh()
 {
+	PROFILE_SCOPE("Planet::generateMesh");
+
 	int rings = 63;
 	int points = 128;
 
@@ -166,6 +141,10 @@ void Planet::generateMesh()
 	double theta = 0.0f;
 	double phi = 0.0f;
 
+	// both poles and every ring carry a seam vertex, sized up front so the mesh is built without regrowing
+	body_vertices.reserve(body_vertices.size() + (size_t)(rings + 2) * (points + 1) * 12);
+	body_indices.reserve(body_indices.size() + (size_t)(rings + 1) * points * 6);
+
 	// generate vertices
 	std::vector<float> vertex;
 
@@ -347,69 +326,125 @@ void Planet::generateMesh()
 	axis_vertices.insert(axis_vertices.end(), vertex.begin(), vertex.end());
 }
 
-void Planet::updatePosition(float delta_time)
+void Planet::updateOrbitCenter(SimulationState &state)
 {
 	if (orbit_anchor)
-	{
-		orbit_center = orbit_anchor->position;
-	}
+		state.bodies[id].orbit_center = state.bodies[orbit_anchor->id].position;
+}
 
-	orbit_offset += orbit_speed * delta_time * solarsystem.time_scale * !solarsystem.paused;
-	orbit_offset = fmod(orbit_offset, 2.0f * 3.1415926f);
+void Planet::updatePosition(SimulationState &state, float delta_time)
+{
+	BodyState &body = state.bodies[id];
+
+	updateOrbitCenter(state);
+
+	body.orbit_offset += body.orbit_speed * delta_time;
+	body.orbit_offset = fmod(body.orbit_offset, 2.0f * 3.1415926f);
 
 	glm::vec3 up = glm::vec3(0.0f, 0.0f, 1.0f);
 	glm::vec3 orbit_plane_i = glm::vec3(glm::cross(up, orbit_axis));
 	glm::vec3 orbit_plane_j = glm::vec3(glm::cross(orbit_axis, orbit_plane_i));
 
-	float orbit_x = cos(orbit_offset) * orbit_radius;
-	float orbit_y = sin(orbit_offset) * orbit_radius;
+	float orbit_x = cos(body.orbit_offset) * orbit_radius;
+	float orbit_y = sin(body.orbit_offset) * orbit_radius;
 
 	if ((glm::length(orbit_plane_i) != 0.0f) && (glm::length(orbit_plane_j) != 0.0f))
 	{
-		position = orbit_center + orbit_x * glm::normalize(orbit_plane_i) + orbit_y * glm::normalize(orbit_plane_j);
+		body.position = body.orbit_center + orbit_x * glm::normalize(orbit_plane_i) + orbit_y * glm::normalize(orbit_plane_j);
 	}
 	else
 	{
-		position = orbit_center + glm::vec3(orbit_x, orbit_y, 0.0f);
+		body.position = body.orbit_center + glm::vec3(orbit_x, orbit_y, 0.0f);
 	}
 }
 
-void Planet::updateRotation(float delta_time)
+void Planet::updateRotation(SimulationState &state, float delta_time)
 {
-	rotation_offset += rotation_speed * delta_time * solarsystem.time_scale * !solarsystem.paused;
-	rotation_offset = fmod(rotation_offset, 2.0f * 3.1415926f);
+	BodyState &body = state.bodies[id];
+
+	body.rotation_offset += rotation_speed * delta_time;
+	body.rotation_offset = fmod(body.rotation_offset, 2.0f * 3.1415926f);
 }
 
-void Planet::updateModelMatrix()
+float mixAngle(float a, float b, float alpha)
+{
+	float delta = b - a;
+	if (delta > 3.1415926f)
+		delta -= 2.0f * 3.1415926f;
+	if (delta < -3.1415926f)
+		delta += 2.0f * 3.1415926f;
+	return a + delta * alpha;
+}
+
+void Planet::applyState(const BodyState &previous, const BodyState &current, float alpha)
+{
+	glm::vec3 next_position = glm::mix(previous.position, current.position, alpha);
+	glm::vec3 next_orbit_center = glm::mix(previous.orbit_center, current.orbit_center, alpha);
+	float next_rotation_offset = mixAngle(previous.rotation_offset, current.rotation_offset, alpha);
+	float next_radius = glm::mix(previous.radius, current.radius, alpha);
+
+	body_dirty |= next_position != position || next_rotation_offset != rotation_offset || next_radius != radius;
+	orbit_dirty |= next_orbit_center != orbit_center;
+
+	position = next_position;
+	orbit_center = next_orbit_center;
+	orbit_offset = mixAngle(previous.orbit_offset, current.orbit_offset, alpha);
+	rotation_offset = next_rotation_offset;
+	radius = next_radius;
+	visible = current.active;
+}
+
+// shortest rotation taking the z axis onto the given axis, none when they are parallel
+static glm::quat getAxisOrientation(glm::vec3 axis)
 {
 	glm::vec3 up = glm::vec3(0.0f, 0.0f, 1.0f);
-	glm::vec3 pole_plane_i = glm::cross(up, pole_axis);
-	glm::vec3 pole_plane_j = glm::cross(pole_axis, pole_plane_i);
-
-	float pole_rotation_offset = acos(glm::dot(glm::normalize(up), glm::normalize(pole_axis)));
-	glm::vec3 pole_rotation_axis = glm::cross(glm::normalize(up), glm::normalize(pole_axis));
-
-	body_model = glm::mat4(1.0f);
-	body_model = glm::translate(body_model, position);
-	body_model = glm::rotate(body_model, rotation_offset, rotation_axis);
-	if (glm::length(pole_rotation_axis) != 0.0f)
-		body_model = glm::rotate(body_model, pole_rotation_offset, glm::normalize(pole_rotation_axis));
-	body_model = glm::scale(body_model, glm::vec3(radius));
-
-	float orbit_rotation_offset = acos(glm::dot(glm::normalize(up), glm::normalize(orbit_axis)));
-	glm::vec3 orbit_rotation_axis = glm::cross(glm::normalize(up), glm::normalize(orbit_axis));
-
-	orbit_model = glm::mat4(1.0f);
-	orbit_model = glm::translate(orbit_model, orbit_center);
-	if (glm::length(orbit_rotation_axis) != 0.0f)
-		orbit_model = glm::rotate(orbit_model, orbit_rotation_offset, glm::normalize(orbit_rotation_axis));
-	orbit_model = glm::scale(orbit_model, glm::vec3(orbit_radius));
-
-	axis_model = glm::mat4(1.0f);
-	axis_model = glm::translate(axis_model, position);
-	if (glm::length(pole_rotation_offset) != 0.0f)
-		axis_model = glm::rotate(axis_model, pole_rotation_offset, glm::normalize(pole_rotation_axis));
-	axis_model = glm::scale(axis_model, glm::vec3(radius));
+	glm::vec3 direction = glm::normalize(axis);
+	glm::vec3 rotation_axis = glm::cross(up, direction);
+	if (glm::length(rotation_axis) == 0.0f)
+		return glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+	return glm::normalize(glm::quat(1.0f + glm::dot(up, direction), rotation_axis));
+}
+
+void Planet::updateOrientation()
+{
+	if (pole_axis != oriented_pole_axis)
+	{
+		oriented_pole_axis = pole_axis;
+		pole_orientation = getAxisOrientation(pole_axis);
+		body_dirty = true;
+	}
+
+	if (orbit_axis != oriented_orbit_axis)
+	{
+		oriented_orbit_axis = orbit_axis;
+		orbit_orientation = getAxisOrientation(orbit_axis);
+		orbit_dirty = true;
+	}
+}
+
+void Planet::updateModelMatrix()
+{
+	updateOrientation();
+
+	// translation, rotation and uniform scale written straight into the columns
+	if (body_dirty)
+	{
+		glm::mat3 pole = glm::mat3_cast(pole_orientation) * radius;
+		glm::mat3 spin = glm::mat3_cast(glm::angleAxis(rotation_offset, glm::normalize(rotation_axis)));
+
+		body_model = glm::mat4(spin * pole);
+		body_model[3] = glm::vec4(position, 1.0f);
+		axis_model = glm::mat4(pole);
+		axis_model[3] = glm::vec4(position, 1.0f);
+		body_dirty = false;
+	}
+
+	if (orbit_dirty)
+	{
+		orbit_model = glm::mat4(glm::mat3_cast(orbit_orientation) * orbit_radius);
+		orbit_model[3] = glm::vec4(orbit_center, 1.0f);
+		orbit_dirty = false;
+	}
 }
 
 void Planet::generateBuffers()
@@ -495,36 +530,52 @@ void Planet::updateBuffers()
 	glBindVertexArray(0);
 }
 
-void Planet::drawBody()
+void Planet::setBodyUniforms(GLuint shader)
 {
-	glUseProgram(body_shader);
-	glUniform3f(glGetUniformLocation(body_shader, "material.color"), material.color.r, material.color.g, material.color.b);
-	glUniform3f(glGetUniformLocation(body_shader, "material.ambient"), material.ambient.r, material.ambient.g, material.ambient.b);
-	glUniform3f(glGetUniformLocation(body_shader, "material.diffuse"), material.diffuse.r, material.diffuse.g, material.diffuse.b);
-	glUniform3f(glGetUniformLocation(body_shader, "material.specular"), material.specular.r, material.specular.g, material.specular.b);
-	glUniform1f(glGetUniformLocation(body_shader, "material.shininess"), material.shininess);
+	glUseProgram(shader);
+	glUniform3f(glGetUniformLocation(shader, "material.color"), material.color.r, material.color.g, material.color.b);
+	glUniform3f(glGetUniformLocation(shader, "material.ambient"), material.ambient.r, material.ambient.g, material.ambient.b);
+	glUniform3f(glGetUniformLocation(shader, "material.diffuse"), material.diffuse.r, material.diffuse.g, material.diffuse.b);
+	glUniform3f(glGetUniformLocation(shader, "material.specular"), material.specular.r, material.specular.g, material.specular.b);
+	glUniform1f(glGetUniformLocation(shader, "material.shininess"), material.shininess);
+
+	glUniform3f(glGetUniformLocation(shader, "ambient"), lighting.ambient.r, lighting.ambient.g, lighting.ambient.b);
+	glUniform1i(glGetUniformLocation(shader, "light_count"), light_count);
+	glUniform1iv(glGetUniformLocation(shader, "light_indices"), light_count, light_indices);
+	glUniform1i(glGetUniformLocation(shader, "occluder_count"), occluder_count);
+	glUniform4fv(glGetUniformLocation(shader, "occluders"), occluder_count, glm::value_ptr(occluders[0]));
+
+	glUniform3f(glGetUniformLocation(shader, "view_pos"), camera.position.x, camera.position.y, camera.position.z);
+	glUniform1i(glGetUniformLocation(shader, "body_texture"), 0);
+	glUseProgram(0);
+}
 
-	glUniform3f(glGetUniformLocation(body_shader, "light.position"), light_source->position.x, light_source->position.y, light_source->position.z);
-	glUniform3f(glGetUniformLocation(body_shader, "light.color"), light_source->light.color.r, light_source->light.color.g, light_source->light.color.b);
-	glUniform3f(glGetUniformLocation(body_shader, "light.ambient"), light_source->light.ambient.r, light_source->light.ambient.g, light_source->light.ambient.b);
-	glUniform3f(glGetUniformLocation(body_shader, "light.diffuse"), light_source->light.diffuse.r, light_source->light.diffuse.g, light_source->light.diffuse.b);
-	glUniform3f(glGetUniformLocation(body_shader, "light.specular"), light_source->light.specular.r, light_source->light.specular.g, light_source->light.specular.b);
+void Planet::drawBody()
+{
+	if (!visible)
+		return;
 
-	glUniform3f(glGetUniformLocation(body_shader, "view_pos"), camera.position.x, camera.position.y, camera.position.z);
-	glUniform1i(glGetUniformLocation(body_shader, "body_texture"), 0);
+	// close up bodies draw their quadtree terrain instead, the sphere is only the fallback until it is ready
+	if (terrain.draw(this))
+		return;
 
+	setBodyUniforms(body_shader);
+	glUseProgram(body_shader);
 	glUniformMatrix4fv(glGetUniformLocation(body_shader, "model"), 1, GL_FALSE, glm::value_ptr(body_model));
 	glUniformMatrix4fv(glGetUniformLocation(body_shader, "view"), 1, GL_FALSE, glm::value_ptr(camera.view));
 	glUniformMatrix4fv(glGetUniformLocation(body_shader, "projection"), 1, GL_FALSE, glm::value_ptr(camera.projection));
 	glUseProgram(0);
 
 	glUseProgram(body_shader);
+	lighting.bind();
 	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, body_texture);
+	glBindTexture(GL_TEXTURE_2D, textures.use(texture_id, camera.getPixelRadius(position, radius)));
 	glBindVertexArray(body_vao);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, body_ebo);
 
 	glDrawElements(GL_TRIANGLES, (GLsizei)body_indices.size(), GL_UNSIGNED_INT, (void *)0);
+	stats.countDraw((int)body_indices.size() / 3);
+	stats.bodies += 1;
 
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 	glBindVertexArray(0);
@@ -534,6 +585,9 @@ void Planet::drawBody()
 
 void Planet::drawOrbit()
 {
+	if (!visible)
+		return;
+
 	glUseProgram(orbit_shader);
 	glUniformMatrix4fv(glGetUniformLocation(orbit_shader, "model"), 1, GL_FALSE, glm::value_ptr(orbit_model));
 	glUniformMatrix4fv(glGetUniformLocation(orbit_shader, "view"), 1, GL_FALSE, glm::value_ptr(camera.view));
@@ -544,6 +598,7 @@ void Planet::drawOrbit()
 	glBindVertexArray(orbit_vao);
 
 	glDrawArrays(GL_LINE_LOOP, 0, (GLsizei)orbit_vertices.size() / 3);
+	stats.countDraw(0);
 
 	glBindVertexArray(0);
 	glUseProgram(0);
@@ -551,6 +606,9 @@ void Planet::drawOrbit()
 
 void Planet::drawAxis()
 {
+	if (!visible)
+		return;
+
 	glUseProgram(axis_shader);
 	glUniformMatrix4fv(glGetUniformLocation(axis_shader, "model"), 1, GL_FALSE, glm::value_ptr(axis_model));
 	glUniformMatrix4fv(glGetUniformLocation(axis_shader, "view"), 1, GL_FALSE, glm::value_ptr(camera.view));
@@ -561,6 +619,7 @@ void Planet::drawAxis()
 	glBindVertexArray(axis_vao);
 
 	glDrawArrays(GL_LINES, 0, (GLsizei)axis_vertices.size() / 3);
+	stats.countDraw(0);
 
 	glBindVertexArray(0);
 	glUseProgram(0);
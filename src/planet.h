@@ -1,8 +1,11 @@
 #pragma once
 
+#include "state.h"
+
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
 
 #include <vector>
 #include <string>
@@ -23,6 +26,9 @@ struct Light
 	glm::vec3 ambient = glm::vec3(0.01f);
 	glm::vec3 diffuse = glm::vec3(0.6f);
 	glm::vec3 specular = glm::vec3(0.2f);
+
+	// distance at which the light has faded out completely, bodies beyond it never see it
+	float range = 10000.0f;
 };
 
 class Planet
@@ -31,11 +37,13 @@ public:
 	glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f);
 
 	float radius = 1.0f;
-	unsigned long int mass = 0;
+	float mass = 1.0f;
 	std::string name = "";
 	int id = 0;
 	bool lines_enabled = true;
 
+	bool visible = true;
+
 	glm::vec3 pole_axis = glm::normalize(glm::vec3(0.0f, 0.0f, 1.0f));
 
 	glm::vec3 rotation_axis = glm::normalize(glm::vec3(0.0f, 0.0f, 1.0f));
@@ -49,9 +57,28 @@ public:
 	float orbit_speed = 0.0f;
 	float orbit_offset = 0.0f;
 
+	// track in the loaded ephemeris that drives this body instead of its orbit, -1 for none
+	int ephemeris_index = -1;
+
 	Material material;
+	// emitters light other bodies, each body shades only the few lights culled for it this frame
 	Light light;
-	Planet *light_source = this;
+	bool emitter = false;
+	int light_count = 0;
+	int light_indices[8] = {};
+	// nearby bodies that can eclipse one of those lights, as center and radius
+	int occluder_count = 0;
+	glm::vec4 occluders[4] = {};
+
+	// orientations depend only on the axes, cached until one of them changes
+	glm::vec3 oriented_pole_axis = glm::vec3(0.0f);
+	glm::vec3 oriented_orbit_axis = glm::vec3(0.0f);
+	glm::quat pole_orientation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+	glm::quat orbit_orientation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+
+	// set when the interpolated state moved, the matrices are only rebuilt for dirty bodies
+	bool body_dirty = true;
+	bool orbit_dirty = true;
 
 	glm::mat4 body_model = glm::mat4(1.0f);
 	glm::mat4 orbit_model = glm::mat4(1.0f);
@@ -67,7 +94,7 @@ public:
 	GLuint body_vbo = 0;
 	GLuint body_ebo = 0;
 	GLuint body_shader = 0;
-	GLuint body_texture = 0;
+	int texture_id = -1;
 
 	GLuint orbit_vao = 0;
 	GLuint orbit_vbo = 0;
@@ -85,11 +112,15 @@ public:
 	void compileShader();
 	void loadTextures();
 	void generateMesh();
-	void updatePosition(float delta_time);
-	void updateRotation(float delta_time);
+	void updateOrbitCenter(SimulationState &state);
+	void updatePosition(SimulationState &state, float delta_time);
+	void updateRotation(SimulationState &state, float delta_time);
+	void applyState(const BodyState &previous, const BodyState &current, float alpha);
+	void updateOrientation();
 	void updateModelMatrix();
 	void generateBuffers();
 	void updateBuffers();
+	void setBodyUniforms(GLuint shader);
 	void drawBody();
 	void drawOrbit();
 	void drawAxis();
@@ -0,0 +1,98 @@
+#include "profiler.h"
+#include "global.h"
+
+#include <vector>
+#include <string>
+#include <mutex>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+
+thread_local ProfileBuffer *thread_profile_buffer = nullptr;
+
+ProfileBuffer *Profiler::registerThread()
+{
+	return profiler.createBuffer("");
+}
+
+ProfileBuffer *Profiler::createBuffer(const std::string &name)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	ProfileBuffer *buffer = new ProfileBuffer;
+	buffer->thread_id = (int)buffers.size();
+	buffer->default_name = name != "" ? name : "thread " + std::to_string(buffer->thread_id);
+	buffer->thread_name = buffer->default_name.c_str();
+	buffers.push_back(buffer);
+
+	return buffer;
+}
+
+bool Profiler::writeTrace(const std::string &path)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	std::vector<std::vector<ProfileEvent>> captures(buffers.size());
+	std::vector<std::string> names(buffers.size());
+	uint64_t origin = UINT64_MAX;
+
+	for (int i = 0; i < buffers.size(); i++)
+	{
+		ProfileBuffer *buffer = buffers[i];
+		std::vector<ProfileEvent> &events = captures[i];
+
+		uint64_t head = buffer->head.load(std::memory_order_acquire);
+		uint64_t first = head > ProfileBuffer::capacity ? head - ProfileBuffer::capacity : 0;
+		events.reserve(head - first);
+		for (uint64_t j = first; j < head; j++)
+			events.push_back(buffer->events[j & (ProfileBuffer::capacity - 1)]);
+		names[i] = buffer->thread_name.load(std::memory_order_acquire);
+
+		// the owning thread kept writing while we copied, every slot up to and including the one it may be writing
+		// now could be torn, which reaches back to overwritten - capacity + 1
+		std::atomic_thread_fence(std::memory_order_acquire);
+		uint64_t overwritten = buffer->head.load(std::memory_order_relaxed);
+		if (overwritten + 1 > ProfileBuffer::capacity + first)
+		{
+			uint64_t count = std::min<uint64_t>(overwritten + 1 - ProfileBuffer::capacity - first, events.size());
+			events.erase(events.begin(), events.begin() + count);
+		}
+
+		for (int j = 0; j < events.size(); j++)
+			origin = std::min(origin, events[j].start);
+	}
+
+	std::ofstream file(path, std::ofstream::out | std::ofstream::trunc);
+	if (!file)
+	{
+		std::cout << "failed to write trace: " << path << "\n";
+		return false;
+	}
+
+	file << std::fixed << std::setprecision(3);
+	file << "{\"traceEvents\":[\n";
+
+	bool first_event = true;
+	for (int i = 0; i < buffers.size(); i++)
+	{
+		if (!first_event)
+			file << ",\n";
+		first_event = false;
+
+		file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffers[i]->thread_id << ",\"args\":{\"name\":\"" << names[i] << "\"}}";
+
+		for (int j = 0; j < captures[i].size(); j++)
+		{
+			ProfileEvent &event = captures[i][j];
+			file << ",\n{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffers[i]->thread_id;
+			file << ",\"ts\":" << (double)(event.start - origin) / 1000.0 << ",\"dur\":" << (double)(event.end - event.start) / 1000.0 << "}";
+		}
+	}
+
+	file << "\n]}\n";
+	file.close();
+
+	std::cout << "wrote trace: " << path << "\n";
+	return true;
+}
\ No newline at end of file
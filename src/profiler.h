@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <string>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+
+#ifdef HELIOS_PROFILER
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__)(name)
+#define PROFILE_THREAD(name) Profiler::getThreadBuffer()->setThreadName(name)
+#else
+#define PROFILE_SCOPE(name)
+#define PROFILE_THREAD(name)
+#endif
+
+struct ProfileEvent
+{
+	const char *name = nullptr;
+	uint64_t start = 0;
+	uint64_t end = 0;
+};
+
+// ring of events written by a single thread, old events are overwritten once it wraps.
+// lock free, a reader copies the slots and then drops whatever the writer may have overwritten meanwhile
+class ProfileBuffer
+{
+public:
+	static constexpr uint64_t capacity = 1 << 16;
+
+	ProfileEvent events[capacity];
+	std::atomic<uint64_t> head = 0;
+
+	int thread_id = 0;
+	std::string default_name = "";
+	// always a string literal or default_name, either outlives the buffer's readers
+	std::atomic<const char *> thread_name = "";
+
+	void record(const char *name, uint64_t start, uint64_t end)
+	{
+		uint64_t index = head.load(std::memory_order_relaxed);
+		// orders the previous publish before this slot write, so a reader that sees the new event also sees the head that covers it
+		std::atomic_thread_fence(std::memory_order_release);
+		events[index & (capacity - 1)] = {name, start, end};
+		head.store(index + 1, std::memory_order_release);
+	}
+
+	void setThreadName(const char *name)
+	{
+		thread_name.store(name, std::memory_order_release);
+	}
+};
+
+class Profiler
+{
+public:
+	std::vector<ProfileBuffer *> buffers;
+	std::mutex mutex;
+
+	std::string trace_path = "helios_trace.json";
+
+	static uint64_t now()
+	{
+		return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	static ProfileBuffer *getThreadBuffer();
+	static ProfileBuffer *registerThread();
+	ProfileBuffer *createBuffer(const std::string &name);
+	bool writeTrace(const std::string &path);
+};
+
+extern thread_local ProfileBuffer *thread_profile_buffer;
+
+inline ProfileBuffer *Profiler::getThreadBuffer()
+{
+	if (!thread_profile_buffer)
+		thread_profile_buffer = registerThread();
+	return thread_profile_buffer;
+}
+
+class ProfileScope
+{
+public:
+	const char *name;
+	uint64_t start;
+
+	ProfileScope(const char *name) : name(name), start(Profiler::now())
+	{
+	}
+
+	~ProfileScope()
+	{
+		Profiler::getThreadBuffer()->record(name, start, Profiler::now());
+	}
+};
\ No newline at end of file
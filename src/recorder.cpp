@@ -0,0 +1,230 @@
+#include "recorder.h"
+#include "global.h"
+
+#include <GLFW/glfw3.h>
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cstring>
+
+bool Recorder::startRecording(const std::string &path)
+{
+	file.open(path, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+	if (!file)
+	{
+		std::cout << "failed to open recording: " << path << "\n";
+		return false;
+	}
+
+	RecordingHeader header;
+	header.time_scale = solarsystem.time_scale;
+	header.paused = solarsystem.paused;
+	file.write((const char *)&header, sizeof(header));
+
+	this->path = path;
+	mode = RecorderMode::RECORD;
+	time = 0.0f;
+	return true;
+}
+
+bool Recorder::startReplay(const std::string &path)
+{
+	std::ifstream input(path, std::ifstream::in | std::ifstream::binary);
+	RecordingHeader header;
+	RecordingHeader expected;
+	input.read((char *)&header, sizeof(header));
+
+	if (!input || memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0 || header.version != expected.version)
+	{
+		std::cout << "not a valid recording: " << path << "\n";
+		return false;
+	}
+
+	InputEvent event;
+	while (input.read((char *)&event, sizeof(event)))
+		events.push_back(event);
+
+	solarsystem.time_scale = header.time_scale;
+	solarsystem.paused = header.paused;
+
+	this->path = path;
+	mode = RecorderMode::REPLAY;
+	time = 0.0f;
+	next_event = 0;
+	return true;
+}
+
+void Recorder::stop()
+{
+	if (mode == RecorderMode::RECORD)
+		file.close();
+
+	if (mode == RecorderMode::REPLAY && stats_path != "")
+		writeFrameTimes(stats_path);
+
+	mode = RecorderMode::NONE;
+}
+
+bool Recorder::isReplaying()
+{
+	return mode == RecorderMode::REPLAY;
+}
+
+bool Recorder::acceptsInput()
+{
+	// during a replay the live window only feeds the recorded events, anything the user does is ignored
+	return mode != RecorderMode::REPLAY || dispatching;
+}
+
+bool Recorder::isFinished()
+{
+	return mode == RecorderMode::REPLAY && next_event >= events.size();
+}
+
+void Recorder::advance(float delta_time)
+{
+	if (mode == RecorderMode::RECORD)
+		time += delta_time;
+}
+
+void Recorder::replayFrame(float frame_time)
+{
+	time += delta_time;
+	frame_times.push_back(frame_time);
+
+	dispatching = true;
+	while (next_event < events.size() && events[next_event].time <= time)
+	{
+		InputEvent &event = events[next_event];
+		next_event += 1;
+
+		switch (event.type)
+		{
+		case InputEventType::KEY:
+			key_callback(window, event.code, 0, event.action, event.mods);
+			break;
+		case InputEventType::BUTTON:
+			mouse_button_callback(window, event.code, event.action, event.mods);
+			break;
+		case InputEventType::CURSOR:
+			mouse_cursor_callback(window, event.x, event.y);
+			break;
+		case InputEventType::SCROLL:
+			mouse_scroll_callback(window, event.x, event.y);
+			break;
+		case InputEventType::TIME_SCALE:
+			solarsystem.time_scale = event.x;
+			break;
+		case InputEventType::PAUSED:
+			solarsystem.paused = event.action;
+			break;
+		}
+	}
+	dispatching = false;
+}
+
+void Recorder::recordKey(int key, int action, int mods)
+{
+	InputEvent event;
+	event.type = InputEventType::KEY;
+	event.code = key;
+	event.action = (uint8_t)action;
+	event.mods = (uint16_t)mods;
+	recordEvent(event);
+}
+
+void Recorder::recordButton(int button, int action, int mods)
+{
+	InputEvent event;
+	event.type = InputEventType::BUTTON;
+	event.code = button;
+	event.action = (uint8_t)action;
+	event.mods = (uint16_t)mods;
+	recordEvent(event);
+}
+
+void Recorder::recordCursor(double x, double y)
+{
+	InputEvent event;
+	event.type = InputEventType::CURSOR;
+	event.x = (float)x;
+	event.y = (float)y;
+	recordEvent(event);
+}
+
+void Recorder::recordScroll(double x, double y)
+{
+	InputEvent event;
+	event.type = InputEventType::SCROLL;
+	event.x = (float)x;
+	event.y = (float)y;
+	recordEvent(event);
+}
+
+void Recorder::recordControls()
+{
+	InputEvent event;
+	event.type = InputEventType::TIME_SCALE;
+	event.x = solarsystem.time_scale;
+	recordEvent(event);
+
+	event.type = InputEventType::PAUSED;
+	event.action = solarsystem.paused;
+	event.x = 0.0f;
+	recordEvent(event);
+}
+
+void Recorder::recordEvent(InputEvent event)
+{
+	if (mode != RecorderMode::RECORD)
+		return;
+
+	event.time = time;
+	file.write((const char *)&event, sizeof(event));
+}
+
+bool Recorder::writeFrameTimes(const std::string &path)
+{
+	std::ofstream output(path, std::ofstream::out | std::ofstream::trunc);
+	if (!output)
+	{
+		std::cout << "failed to write frame times: " << path << "\n";
+		return false;
+	}
+
+	std::vector<float> sorted = frame_times;
+	std::sort(sorted.begin(), sorted.end());
+
+	float mean = 0.0f;
+	for (int i = 0; i < sorted.size(); i++)
+		mean += sorted[i] / (float)sorted.size();
+
+	auto percentile = [&](int p) -> float
+	{
+		if (sorted.empty())
+			return 0.0f;
+		return sorted[(sorted.size() - 1) * p / 100];
+	};
+
+	output << std::fixed << std::setprecision(6);
+	output << "{\n";
+	output << "\t\"recording\": \"" << this->path << "\",\n";
+	output << "\t\"delta_time\": " << delta_time << ",\n";
+	output << "\t\"frames\": " << frame_times.size() << ",\n";
+	output << "\t\"mean\": " << mean << ",\n";
+	output << "\t\"p50\": " << percentile(50) << ",\n";
+	output << "\t\"p95\": " << percentile(95) << ",\n";
+	output << "\t\"p99\": " << percentile(99) << ",\n";
+	output << "\t\"max\": " << (sorted.empty() ? 0.0f : sorted.back()) << ",\n";
+	output << "\t\"frame_times\": [";
+	for (int i = 0; i < frame_times.size(); i++)
+		output << (i ? ", " : "") << frame_times[i];
+	output << "]\n}\n";
+
+	std::cout << "wrote frame times: " << path << "\n";
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <GLFW/glfw3.h>
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdint>
+
+enum class RecorderMode
+{
+	NONE,
+	RECORD,
+	REPLAY
+};
+
+enum class InputEventType : uint8_t
+{
+	KEY,
+	BUTTON,
+	CURSOR,
+	SCROLL,
+	TIME_SCALE,
+	PAUSED
+};
+
+#pragma pack(push, 1)
+struct RecordingHeader
+{
+	char magic[4] = {'H', 'R', 'E', 'C'};
+	uint32_t version = 1;
+	float time_scale = 1.0f;
+	uint8_t paused = 0;
+};
+
+struct InputEvent
+{
+	float time = 0.0f;
+	InputEventType type = InputEventType::KEY;
+	uint8_t action = 0;
+	uint16_t mods = 0;
+	int32_t code = 0;
+	float x = 0.0f;
+	float y = 0.0f;
+};
+#pragma pack(pop)
+
+class Recorder
+{
+public:
+	RecorderMode mode = RecorderMode::NONE;
+	std::string path = "";
+
+	std::ofstream file;
+	std::vector<InputEvent> events;
+	int next_event = 0;
+	bool dispatching = false;
+
+	float time = 0.0f;
+	float delta_time = 1.0f / 60.0f;
+
+	std::vector<float> frame_times;
+	std::string stats_path = "";
+
+	GLFWwindow *window = nullptr;
+	GLFWkeyfun key_callback = nullptr;
+	GLFWmousebuttonfun mouse_button_callback = nullptr;
+	GLFWcursorposfun mouse_cursor_callback = nullptr;
+	GLFWscrollfun mouse_scroll_callback = nullptr;
+
+	bool startRecording(const std::string &path);
+	bool startReplay(const std::string &path);
+	void stop();
+
+	bool isReplaying();
+	bool acceptsInput();
+	bool isFinished();
+
+	void advance(float delta_time);
+	void replayFrame(float frame_time);
+
+	void recordKey(int key, int action, int mods);
+	void recordButton(int button, int action, int mods);
+	void recordCursor(double x, double y);
+	void recordScroll(double x, double y);
+	void recordControls();
+	void recordEvent(InputEvent event);
+
+	bool writeFrameTimes(const std::string &path);
+};
\ No newline at end of file
@@ -0,0 +1,247 @@
+#include "simulation.h"
+#include "global.h"
+#include "profiler.h"
+#include "arena.h"
+
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+
+using Clock = std::chrono::steady_clock;
+
+void Simulation::initialize()
+{
+	state.bodies.resize(solarsystem.planets.size());
+	for (int i = 0; i < solarsystem.planets.size(); i++)
+	{
+		state.bodies[i].orbit_center = solarsystem.planets[i]->orbit_center;
+		state.bodies[i].orbit_offset = solarsystem.planets[i]->orbit_offset;
+		state.bodies[i].rotation_offset = solarsystem.planets[i]->rotation_offset;
+		state.bodies[i].orbit_speed = solarsystem.planets[i]->orbit_speed;
+		state.bodies[i].radius = solarsystem.planets[i]->radius;
+		state.bodies[i].mass = solarsystem.planets[i]->mass;
+	}
+	solarsystem.updatePlanets(state, 0.0f);
+	history.reset(state);
+	checkpoint_count = (int)history.checkpoints.size();
+
+	Clock::time_point now = Clock::now();
+	state.published = now;
+	for (int i = 0; i < 3; i++)
+	{
+		buffer.buffers[i].previous = state;
+		buffer.buffers[i].current = state;
+	}
+	last = state;
+	previous = state;
+	current = state;
+
+	solarsystem.interpolated_time = -1.0;
+	solarsystem.interpolatePlanets(previous, current, 1.0f);
+}
+
+void Simulation::start()
+{
+	if (!threaded)
+		return;
+
+	running = true;
+	thread = std::thread(&Simulation::run, this);
+}
+
+void Simulation::stop()
+{
+	running = false;
+	if (thread.joinable())
+		thread.join();
+}
+
+void Simulation::run()
+{
+	PROFILE_THREAD("simulation");
+
+	Clock::duration interval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(step_size));
+	Clock::time_point next = Clock::now();
+
+	while (running)
+	{
+		applyRestore();
+		applySeek();
+		gravity.applyToggle(state);
+		step();
+		publish(next);
+
+		// scratch memory of the step, the simulation thread has no frames of its own
+		frameArena().reset();
+
+		next += interval;
+
+		// too slow to keep up in real time, let simulated time fall behind instead of spiraling
+		Clock::time_point now = Clock::now();
+		if (now - next > interval * max_lag_steps)
+			next = now;
+
+		std::this_thread::sleep_until(next);
+	}
+}
+
+void Simulation::step()
+{
+	PROFILE_SCOPE("Simulation::step");
+
+	Clock::time_point start = Clock::now();
+	float delta_time = step_size * solarsystem.time_scale * !solarsystem.paused;
+
+	integrate(delta_time);
+	collisions.detect(state, delta_time);
+	state.time += delta_time;
+	state.step += 1;
+	history.record(state);
+	checkpoint_count = (int)history.checkpoints.size();
+
+	float time = std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+	step_time = step_time + (time - step_time) * 0.05f;
+
+	// the more a step costs the closer checkpoints sit, so seeking between two of them stays within seek_budget
+	history.setBaseInterval(getSeekSteps() * getSeekDelta());
+}
+
+void Simulation::integrate(float delta_time)
+{
+	if (state.gravity)
+		gravity.advance(state, delta_time);
+	solarsystem.updatePlanets(state, delta_time);
+}
+
+void Simulation::advance(float delta_time)
+{
+	applyRestore();
+	applySeek();
+	gravity.applyToggle(state);
+
+	accumulator += delta_time;
+	while (accumulator >= step_size)
+	{
+		step();
+		publish(Clock::now());
+		accumulator -= step_size;
+	}
+}
+
+void Simulation::seek(double time)
+{
+	seek_target.store(time, std::memory_order_relaxed);
+	seek_requested.store(true, std::memory_order_release);
+}
+
+void Simulation::applySeek()
+{
+	if (!seek_requested.exchange(false, std::memory_order_acquire))
+		return;
+
+	PROFILE_SCOPE("Simulation::seek");
+
+	double target = std::max(seek_target.load(std::memory_order_relaxed), history.checkpoints.front().time);
+	int index = history.find(target);
+	copyState(state, history.checkpoints[index]);
+
+	// checkpoints past the target would mix with a timeline changed from here on, record() only appends past the last one
+	history.truncate(history.checkpoints[index].time);
+	checkpoint_count = (int)history.checkpoints.size();
+	collisions.reset();
+
+	// integrate forward from the checkpoint like live steps do, only widening them if the gap would take too long
+	double remaining = target - state.time;
+	double delta_time = std::max(getSeekDelta(), remaining / getSeekSteps());
+	while (remaining > 0.0)
+	{
+		float delta = (float)std::min(delta_time, remaining);
+		integrate(delta);
+		collisions.detect(state, delta);
+		state.time += delta;
+		state.step += 1;
+		remaining -= delta;
+	}
+
+	// start interpolating from the new position instead of sweeping across the jump
+	copyState(last, state);
+}
+
+int Simulation::getSeekSteps()
+{
+	return std::clamp((int)(seek_budget / std::max((float)step_time, 1e-3f)), min_seek_steps, max_seek_steps);
+}
+
+double Simulation::getSeekDelta()
+{
+	return (double)step_size * std::max(std::abs((double)solarsystem.time_scale), 1.0);
+}
+
+bool Simulation::restore(const SimulationState &snapshot)
+{
+	if (restore_requested.load(std::memory_order_acquire))
+		return false;
+
+	copyState(pending, snapshot);
+	restore_requested.store(true, std::memory_order_release);
+	return true;
+}
+
+void Simulation::applyRestore()
+{
+	if (!restore_requested.load(std::memory_order_acquire))
+		return;
+
+	PROFILE_SCOPE("Simulation::restore");
+
+	// history before the snapshot belongs to another run, seeking starts over from here
+	copyState(state, pending);
+	history.reset(state);
+	checkpoint_count = (int)history.checkpoints.size();
+	copyState(last, state);
+	collisions.reset();
+
+	restore_requested.store(false, std::memory_order_release);
+}
+
+void Simulation::publish(Clock::time_point time)
+{
+	state.published = time;
+
+	SimulationFrame &back = buffer.getBack();
+	copyState(back.previous, last);
+	copyState(back.current, state);
+	copyState(last, state);
+
+	buffer.publish();
+}
+
+void Simulation::interpolate()
+{
+	if (buffer.update())
+	{
+		SimulationFrame &front = buffer.getFront();
+		copyState(previous, front.previous);
+		copyState(current, front.current);
+	}
+
+	// render one step behind the simulation, blending towards the newest state as its interval elapses
+	float alpha = std::chrono::duration<float>(Clock::now() - current.published).count() / step_size;
+	if (!threaded)
+		alpha = accumulator / step_size;
+	alpha = std::clamp(alpha, 0.0f, 1.0f);
+
+	solarsystem.interpolatePlanets(previous, current, alpha);
+}
+
+void Simulation::copyState(SimulationState &destination, const SimulationState &source)
+{
+	// assign keeps the destination's capacity, so steady state copies never allocate
+	destination.bodies.assign(source.bodies.begin(), source.bodies.end());
+	destination.time = source.time;
+	destination.step = source.step;
+	destination.gravity = source.gravity;
+	destination.published = source.published;
+}
\ No newline at end of file
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "state.h"
+#include "history.h"
+#include "collisions.h"
+#include "gravity.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <cstdint>
+
+struct SimulationFrame
+{
+	SimulationState previous;
+	SimulationState current;
+};
+
+// single producer, single consumer triple buffer, neither side ever blocks
+template <typename T>
+class TripleBuffer
+{
+public:
+	T buffers[3];
+
+	// bits 0-1 hold the index of the shared buffer, bit 2 is set while it holds data the reader hasn't seen
+	std::atomic<int> middle = 1;
+	int back = 0;
+	int front = 2;
+
+	T &getBack()
+	{
+		return buffers[back];
+	}
+
+	T &getFront()
+	{
+		return buffers[front];
+	}
+
+	void publish()
+	{
+		back = middle.exchange(back | 4, std::memory_order_acq_rel) & 3;
+	}
+
+	bool update()
+	{
+		if (!(middle.load(std::memory_order_acquire) & 4))
+			return false;
+
+		front = middle.exchange(front, std::memory_order_acq_rel) & 3;
+		return true;
+	}
+};
+
+class Simulation
+{
+public:
+	float step_size = 1.0f / 240.0f;
+	int max_lag_steps = 4;
+	std::atomic<float> step_time = 0.0f;
+
+	// stepped from the render loop instead of its own thread, used for deterministic replays
+	bool threaded = true;
+	float accumulator = 0.0f;
+
+	SimulationState state;
+	SimulationState last;
+	TripleBuffer<SimulationFrame> buffer;
+
+	SimulationState previous;
+	SimulationState current;
+
+	// only touched by whichever side steps the simulation, the render side posts seeks through the atomics
+	History history;
+	Collisions collisions;
+	Gravity gravity;
+	// wall clock milliseconds a seek may spend integrating, checkpoints are spaced so it never needs more
+	float seek_budget = 50.0f;
+	int min_seek_steps = 16;
+	int max_seek_steps = 2048;
+	std::atomic<bool> seek_requested = false;
+	std::atomic<double> seek_target = 0.0;
+	std::atomic<int> checkpoint_count = 0;
+
+	// a loaded snapshot posted from the render side, swapped in the same way as a seek
+	SimulationState pending;
+	std::atomic<bool> restore_requested = false;
+
+	std::thread thread;
+	std::atomic<bool> running = false;
+
+	void initialize();
+	void start();
+	void stop();
+	void run();
+	void step();
+	void integrate(float delta_time);
+	void advance(float delta_time);
+	void seek(double time);
+	void applySeek();
+	int getSeekSteps();
+	double getSeekDelta();
+	bool restore(const SimulationState &snapshot);
+	void applyRestore();
+	void publish(std::chrono::steady_clock::time_point time);
+	void interpolate();
+	void copyState(SimulationState &destination, const SimulationState &source);
+};
\ No newline at end of file
@@ -0,0 +1,211 @@
+#include "skybox.h"
+#include "global.h"
+#include "profiler.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <stb_image/stb_image.h>
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <cmath>
+
+void Skybox::initialize()
+{
+	compileShader();
+	loadTexture();
+
+	// the full screen triangle is generated from gl_VertexID, the vao only exists because core profile needs one bound
+	glGenVertexArrays(1, &vao);
+}
+
+void Skybox::compileShader()
+{
+	const char *vert_source;
+
+	std::ifstream vert_file(shader_path + ".vs");
+	std::string vert_string((std::istreambuf_iterator<char>(vert_file)), std::istreambuf_iterator<char>());
+	vert_source = vert_string.c_str();
+
+	unsigned int vert_shader;
+	vert_shader = glCreateShader(GL_VERTEX_SHADER);
+
+	glShaderSource(vert_shader, 1, &vert_source, NULL);
+	glCompileShader(vert_shader);
+
+	const char *frag_source;
+
+	std::ifstream frag_file(shader_path + ".fs");
+	std::string frag_string((std::istreambuf_iterator<char>(frag_file)), std::istreambuf_iterator<char>());
+	frag_source = frag_string.c_str();
+
+	unsigned int frag_shader;
+	frag_shader = glCreateShader(GL_FRAGMENT_SHADER);
+
+	glShaderSource(frag_shader, 1, &frag_source, NULL);
+	glCompileShader(frag_shader);
+
+	shader = glCreateProgram();
+
+	glAttachShader(shader, vert_shader);
+	glAttachShader(shader, frag_shader);
+	glLinkProgram(shader);
+
+	glDeleteShader(vert_shader);
+	glDeleteShader(frag_shader);
+}
+
+void Skybox::loadTexture()
+{
+	PROFILE_SCOPE("Skybox::loadTexture");
+
+	int width, height, channels;
+	stbi_set_flip_vertically_on_load(true);
+	unsigned char *data = stbi_load(texture_path.c_str(), &width, &height, &channels, 3);
+	if (!data)
+	{
+		std::cout << "failed to load skybox: " << texture_path << "\n";
+		enabled = false;
+		return;
+	}
+
+	int size = face_size > 0 ? face_size : std::max(width / 4, 1);
+	face_size = size;
+	int levels = (int)std::floor(std::log2((float)size)) + 1;
+
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+	glTexStorage2D(GL_TEXTURE_CUBE_MAP, levels, GL_RGB8, size, size);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	std::vector<unsigned char> pixels;
+	for (int face = 0; face < 6; face++)
+	{
+		convertFace(data, width, height, face, pixels);
+		glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, 0, 0, size, size, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+	}
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+	glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+
+	stbi_image_free(data);
+}
+
+void Skybox::convertFace(const unsigned char *source, int width, int height, int face, std::vector<unsigned char> &pixels)
+{
+	PROFILE_SCOPE("Skybox::convertFace");
+
+	int size = face_size;
+	pixels.resize((size_t)size * size * 3);
+
+	jobs.parallelFor(size, grain, [&](int begin, int end)
+	{
+		for (int y = begin; y < end; y++)
+		{
+			for (int x = 0; x < size; x++)
+			{
+				glm::vec3 direction = getFaceDirection(face, (x + 0.5f) / size, (y + 0.5f) / size);
+				glm::vec3 color = sampleEquirect(source, width, height, direction);
+				unsigned char *texel = &pixels[((size_t)y * size + x) * 3];
+				texel[0] = (unsigned char)(color.r + 0.5f);
+				texel[1] = (unsigned char)(color.g + 0.5f);
+				texel[2] = (unsigned char)(color.b + 0.5f);
+			}
+		}
+	});
+}
+
+glm::vec3 Skybox::sampleEquirect(const unsigned char *source, int width, int height, glm::vec3 direction)
+{
+	// same mapping the background sphere mesh used, longitude around z and v running from the north pole
+	double pi = 3.1415926;
+	direction = glm::normalize(direction);
+	double phi = std::atan2((double)direction.y, (double)direction.x);
+	if (phi < 0.0)
+		phi += 2.0 * pi;
+	double theta = std::acos(glm::clamp((double)direction.z, -1.0, 1.0));
+
+	float u = (float)(phi / (2.0 * pi)) * width - 0.5f;
+	float v = (float)(theta / pi) * height - 0.5f;
+
+	int x0 = (int)std::floor(u);
+	int y0 = (int)std::floor(v);
+	float fx = u - x0;
+	float fy = v - y0;
+
+	// wrap around the seam, clamp at the poles
+	auto texel = [&](int x, int y)
+	{
+		x = ((x % width) + width) % width;
+		y = glm::clamp(y, 0, height - 1);
+		const unsigned char *p = &source[((size_t)y * width + x) * 3];
+		return glm::vec3(p[0], p[1], p[2]);
+	};
+
+	glm::vec3 top = glm::mix(texel(x0, y0), texel(x0 + 1, y0), fx);
+	glm::vec3 bottom = glm::mix(texel(x0, y0 + 1), texel(x0 + 1, y0 + 1), fx);
+	return glm::mix(top, bottom, fy);
+}
+
+glm::vec3 Skybox::getFaceDirection(int face, float s, float t)
+{
+	// the direction gl looks up for texel (s, t) of each face, in GL_TEXTURE_CUBE_MAP_POSITIVE_X + face order
+	float sc = 2.0f * s - 1.0f;
+	float tc = 2.0f * t - 1.0f;
+	switch (face)
+	{
+	case 0:
+		return glm::vec3(1.0f, -tc, -sc);
+	case 1:
+		return glm::vec3(-1.0f, -tc, sc);
+	case 2:
+		return glm::vec3(sc, 1.0f, tc);
+	case 3:
+		return glm::vec3(sc, -1.0f, -tc);
+	case 4:
+		return glm::vec3(sc, -tc, 1.0f);
+	default:
+		return glm::vec3(-sc, -tc, -1.0f);
+	}
+}
+
+void Skybox::draw()
+{
+	if (!enabled)
+		return;
+
+	PROFILE_SCOPE("Skybox::draw");
+
+	// rotation only, the sky sits at infinity
+	glm::mat4 inverse_view_projection = glm::inverse(camera.projection * glm::mat4(glm::mat3(camera.view)));
+
+	glUseProgram(shader);
+	glUniformMatrix4fv(glGetUniformLocation(shader, "inverse_view_projection"), 1, GL_FALSE, glm::value_ptr(inverse_view_projection));
+	glUniform1i(glGetUniformLocation(shader, "sky_texture"), 0);
+
+	// drawn at the far plane after the bodies, so early depth testing skips every pixel they already cover
+	glDepthFunc(GL_LEQUAL);
+	glDepthMask(GL_FALSE);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+	glBindVertexArray(vao);
+
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	stats.countDraw(1);
+
+	glBindVertexArray(0);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+	glDepthMask(GL_TRUE);
+	glDepthFunc(GL_LESS);
+	glUseProgram(0);
+}
\ No newline at end of file
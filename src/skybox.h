@@ -0,0 +1,31 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <string>
+
+class Skybox
+{
+public:
+	bool enabled = true;
+
+	// an equirectangular image is resampled into cube faces once at load, face_size 0 picks a quarter of its width
+	std::string texture_path = "res/textures/8k_stars_milky_way.jpg";
+	std::string shader_path = "res/shaders/skybox";
+	int face_size = 0;
+	int grain = 16;
+
+	GLuint texture = 0;
+	GLuint shader = 0;
+	GLuint vao = 0;
+
+	void initialize();
+	void compileShader();
+	void loadTexture();
+	void convertFace(const unsigned char *source, int width, int height, int face, std::vector<unsigned char> &pixels);
+	glm::vec3 sampleEquirect(const unsigned char *source, int width, int height, glm::vec3 direction);
+	static glm::vec3 getFaceDirection(int face, float s, float t);
+	void draw();
+};
\ No newline at end of file
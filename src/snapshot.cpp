@@ -0,0 +1,157 @@
+#include "snapshot.h"
+#include "mapped_file.h"
+#include "global.h"
+#include "profiler.h"
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <filesystem>
+#include <memory>
+#include <cstring>
+
+void Snapshot::save(const SimulationState &state)
+{
+	if (writing.exchange(true))
+	{
+		std::cout << "snapshot still being written, skipped\n";
+		return;
+	}
+
+	// encoding is a copy the caller has to wait for anyway, only the disk write goes to the background
+	std::shared_ptr<std::vector<uint8_t>> data = std::make_shared<std::vector<uint8_t>>();
+	encode(state, *data);
+
+	std::string target = path;
+	jobs.submit([this, data, target]
+	{
+		PROFILE_SCOPE("Snapshot::store");
+		if (store(*data, target))
+			std::cout << "saved snapshot: " << target << "\n";
+		writing = false;
+	});
+}
+
+bool Snapshot::write(const SimulationState &state, const std::string &path)
+{
+	std::vector<uint8_t> data;
+	encode(state, data);
+	return store(data, path);
+}
+
+bool Snapshot::load(const std::string &path, SimulationState &state)
+{
+	PROFILE_SCOPE("Snapshot::load");
+
+	MappedFile file;
+	if (!file.open(path))
+	{
+		std::cout << "failed to open snapshot: " << path << "\n";
+		return false;
+	}
+
+	SnapshotHeader header;
+	SnapshotHeader expected;
+	if (file.size >= sizeof(header))
+		memcpy(&header, file.data, sizeof(header));
+	if (file.size < sizeof(header) || memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0 || header.version != expected.version ||
+		header.header_size != sizeof(SnapshotHeader) || header.body_size != sizeof(SnapshotBody) ||
+		file.size < header.header_size + header.body_count * header.body_size)
+	{
+		std::cout << "not a valid snapshot: " << path << "\n";
+		return false;
+	}
+
+	if (header.body_count != state.bodies.size())
+	{
+		std::cout << "snapshot has " << header.body_count << " bodies, the scene has " << state.bodies.size() << ": " << path << "\n";
+		return false;
+	}
+
+	// records are read straight out of the mapping, nothing is parsed or staged
+	const SnapshotBody *bodies = (const SnapshotBody *)(file.data + header.header_size);
+	jobs.parallelFor((int)header.body_count, grain, [&](int begin, int end)
+	{
+		for (int i = begin; i < end; i++)
+		{
+			const SnapshotBody &source = bodies[i];
+			BodyState &body = state.bodies[i];
+			body.position = source.position;
+			body.velocity = source.velocity;
+			body.orbit_center = source.orbit_center;
+			body.orbit_offset = source.orbit_offset;
+			body.rotation_offset = source.rotation_offset;
+			body.orbit_speed = source.orbit_speed;
+			body.radius = source.radius;
+			body.mass = source.mass;
+			body.active = source.active != 0;
+		}
+	});
+
+	state.time = header.time;
+	state.step = header.step;
+	state.gravity = header.gravity != 0;
+	solarsystem.time_scale = header.time_scale;
+	solarsystem.paused = header.paused != 0;
+	return true;
+}
+
+void Snapshot::encode(const SimulationState &state, std::vector<uint8_t> &data)
+{
+	PROFILE_SCOPE("Snapshot::encode");
+
+	SnapshotHeader header;
+	header.body_size = sizeof(SnapshotBody);
+	header.body_count = state.bodies.size();
+	header.time = state.time;
+	header.step = state.step;
+	header.time_scale = solarsystem.time_scale;
+	header.paused = solarsystem.paused;
+	header.gravity = state.gravity;
+
+	data.resize(sizeof(header) + state.bodies.size() * sizeof(SnapshotBody));
+	memcpy(data.data(), &header, sizeof(header));
+
+	SnapshotBody *bodies = (SnapshotBody *)(data.data() + sizeof(header));
+	jobs.parallelFor((int)state.bodies.size(), grain, [&](int begin, int end)
+	{
+		for (int i = begin; i < end; i++)
+		{
+			const BodyState &body = state.bodies[i];
+			SnapshotBody &target = bodies[i];
+			target.position = body.position;
+			target.velocity = body.velocity;
+			target.orbit_center = body.orbit_center;
+			target.orbit_offset = body.orbit_offset;
+			target.rotation_offset = body.rotation_offset;
+			target.orbit_speed = body.orbit_speed;
+			target.radius = body.radius;
+			target.mass = body.mass;
+			target.active = body.active;
+		}
+	});
+}
+
+bool Snapshot::store(const std::vector<uint8_t> &data, const std::string &path)
+{
+	// written beside the target and renamed over it, a reader never maps a half written file
+	std::string temporary = path + ".tmp";
+	std::ofstream file(temporary, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+	file.write((const char *)data.data(), (std::streamsize)data.size());
+	file.close();
+	if (!file)
+	{
+		std::cout << "failed to write snapshot: " << path << "\n";
+		return false;
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temporary, path, error);
+	if (error)
+	{
+		std::cout << "failed to write snapshot: " << path << "\n";
+		return false;
+	}
+	return true;
+}
\ No newline at end of file
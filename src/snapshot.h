@@ -0,0 +1,57 @@
+#pragma once
+
+#include "state.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <string>
+#include <atomic>
+#include <cstdint>
+
+// bump the version whenever either record changes, old files are rejected rather than misread
+#pragma pack(push, 1)
+struct SnapshotHeader
+{
+	char magic[4] = {'H', 'S', 'N', 'P'};
+	uint32_t version = 1;
+	uint32_t header_size = sizeof(SnapshotHeader);
+	uint32_t body_size = 0;
+	uint64_t body_count = 0;
+	double time = 0.0;
+	uint64_t step = 0;
+	float time_scale = 1.0f;
+	uint8_t paused = 0;
+	uint8_t gravity = 0;
+	uint8_t padding[2] = {};
+};
+
+struct SnapshotBody
+{
+	glm::vec3 position = glm::vec3(0.0f);
+	glm::vec3 velocity = glm::vec3(0.0f);
+	glm::vec3 orbit_center = glm::vec3(0.0f);
+	float orbit_offset = 0.0f;
+	float rotation_offset = 0.0f;
+	float orbit_speed = 0.0f;
+	float radius = 0.0f;
+	float mass = 0.0f;
+	uint32_t active = 0;
+};
+#pragma pack(pop)
+
+class Snapshot
+{
+public:
+	std::string path = "snapshot.hsnp";
+	int grain = 4096;
+
+	// a save in flight, further saves are dropped until it lands
+	std::atomic<bool> writing = false;
+
+	void save(const SimulationState &state);
+	bool write(const SimulationState &state, const std::string &path);
+	bool load(const std::string &path, SimulationState &state);
+	void encode(const SimulationState &state, std::vector<uint8_t> &data);
+	static bool store(const std::vector<uint8_t> &data, const std::string &path);
+};
\ No newline at end of file
@@ -1,4 +1,6 @@
 #include "solarsystem.h"
+#include "profiler.h"
+#include "global.h"
 
 #include <glm/glm.hpp>
 
@@ -7,126 +9,122 @@
 
 void Solarsystem::initializePlanets()
 {
-	for (int i = 0; i < 9; i++)
+	for (int i = 0; i < 8; i++)
 	{
 		Planet *planet = new Planet;
 		planets.push_back(planet);
 	}
 
-	planets[0]->name = "U0";
+	planets[0]->name = "S1";
 	planets[0]->id = 0;
 	planets[0]->orbit_center = glm::vec3(0.0f, 0.0f, 0.0f);
-	planets[0]->radius = 100000.0f;
+	planets[0]->radius = 8.0f;
+	planets[0]->mass = 10000.0f;
+	planets[0]->emitter = true;
+	planets[0]->rotation_speed = -0.2f;
 	planets[0]->body_shader_path = "res/shaders/sun_body";
-	planets[0]->texture_path = "res/textures/8k_stars_milky_way.jpg";
-	planets[0]->lines_enabled = false;
+	planets[0]->texture_path = "res/textures/8k_sun.jpg";
 
-	planets[1]->name = "S1";
+	planets[1]->name = "S1-P1";
 	planets[1]->id = 1;
-	planets[1]->orbit_center = glm::vec3(0.0f, 0.0f, 0.0f);
-	planets[1]->radius = 8.0f;
-	planets[1]->rotation_speed = -0.2f;
-	planets[1]->body_shader_path = "res/shaders/sun_body";
-	planets[1]->texture_path = "res/textures/8k_sun.jpg";
+	planets[1]->radius = 1.0f;
+	planets[1]->mass = 1.0f;
+	planets[1]->rotation_speed = 1.4f;
+	planets[1]->orbit_anchor = planets[0];
+	planets[1]->orbit_radius = 15.0f;
+	planets[1]->orbit_speed = 1.0f;
+	planets[1]->orbit_offset = 3.0f;
+	planets[1]->rotation_axis = glm::normalize(glm::vec3(0.1f, -0.2f, 1.0f));
+	planets[1]->pole_axis = glm::normalize(glm::vec3(0.1f, -0.2f, 1.0f));
+	planets[1]->orbit_axis = glm::normalize(glm::vec3(0.1f, -0.2f, 1.0f));
+	planets[1]->texture_path = "res/textures/8k_mars.jpg";
 
-	planets[2]->name = "S1-P1";
+	planets[2]->name = "S1-P2";
 	planets[2]->id = 2;
-	planets[2]->radius = 1.0f;
-	planets[2]->rotation_speed = 1.4f;
-	planets[2]->orbit_anchor = planets[1];
-	planets[2]->orbit_radius = 15.0f;
-	planets[2]->orbit_speed = 1.0f;
-	planets[2]->orbit_offset = 3.0f;
-	planets[2]->light_source = planets[1];
-	planets[2]->rotation_axis = glm::normalize(glm::vec3(0.1f, -0.2f, 1.0f));
-	planets[2]->pole_axis = glm::normalize(glm::vec3(0.1f, -0.2f, 1.0f));
-	planets[2]->orbit_axis = glm::normalize(glm::vec3(0.1f, -0.2f, 1.0f));
-	planets[2]->texture_path = "res/textures/8k_mars.jpg";
-
-	planets[3]->name = "S1-P2";
+	planets[2]->radius = 2.0f;
+	planets[2]->mass = 5.0f;
+	planets[2]->rotation_speed = 0.8f;
+	planets[2]->orbit_anchor = planets[0];
+	planets[2]->orbit_radius = 30.0f;
+	planets[2]->orbit_speed = -0.6f;
+	planets[2]->orbit_offset = 1.0f;
+	planets[2]->rotation_axis = glm::normalize(glm::vec3(0.0f, 0.1f, 1.0f));
+	planets[2]->pole_axis = glm::normalize(glm::vec3(0.0f, 0.1f, 1.0f));
+	planets[2]->orbit_axis = glm::normalize(glm::vec3(0.0f, 0.1f, 1.0f));
+	planets[2]->texture_path = "res/textures/8k_mercury.jpg";
+
+	planets[3]->name = "S1-P3";
 	planets[3]->id = 3;
-	planets[3]->radius = 2.0f;
-	planets[3]->rotation_speed = 0.8f;
-	planets[3]->orbit_anchor = planets[1];
-	planets[3]->orbit_radius = 30.0f;
-	planets[3]->orbit_speed = -0.6f;
-	planets[3]->orbit_offset = 1.0f;
-	planets[3]->light_source = planets[1];
-	planets[3]->rotation_axis = glm::normalize(glm::vec3(0.0f, 0.1f, 1.0f));
-	planets[3]->pole_axis = glm::normalize(glm::vec3(0.0f, 0.1f, 1.0f));
-	planets[3]->orbit_axis = glm::normalize(glm::vec3(0.0f, 0.1f, 1.0f));
-	planets[3]->texture_path = "res/textures/8k_mercury.jpg";
-
-	planets[4]->name = "S1-P3";
+	planets[3]->radius = 5.0f;
+	planets[3]->mass = 1500.0f;
+	planets[3]->rotation_speed = 0.3f;
+	planets[3]->orbit_anchor = planets[0];
+	planets[3]->orbit_radius = 60.0f;
+	planets[3]->orbit_speed = 0.1f;
+	planets[3]->orbit_offset = 2.0f;
+	planets[3]->texture_path = "res/textures/8k_jupiter.jpg";
+
+	planets[4]->name = "S1-P3-M1";
 	planets[4]->id = 4;
-	planets[4]->radius = 5.0f;
-	planets[4]->rotation_speed = 0.3f;
-	planets[4]->orbit_anchor = planets[1];
-	planets[4]->orbit_radius = 60.0f;
-	planets[4]->orbit_speed = 0.1f;
-	planets[4]->orbit_offset = 2.0f;
-	planets[4]->light_source = planets[1];
-	planets[4]->texture_path = "res/textures/8k_jupiter.jpg";
-
-	planets[5]->name = "S1-P3-M1";
+	planets[4]->radius = 0.5f;
+	planets[4]->mass = 1.0f;
+	planets[4]->rotation_speed = -2.0f;
+	planets[4]->orbit_anchor = planets[3];
+	planets[4]->orbit_axis = glm::normalize(glm::vec3(0.8f, 0.0f, 1.0f));
+	planets[4]->orbit_radius = 10.0f;
+	planets[4]->orbit_speed = 2.0f;
+	planets[4]->orbit_offset = 0.0f;
+	planets[4]->rotation_axis = glm::normalize(glm::vec3(0.8f, 0.0f, 1.0f));
+	planets[4]->pole_axis = glm::normalize(glm::vec3(0.8f, 0.0f, 1.0f));
+	planets[4]->texture_path = "res/textures/4k_ceres_fictional.jpg";
+
+	planets[5]->name = "S1-P4";
 	planets[5]->id = 5;
-	planets[5]->radius = 0.5f;
-	planets[5]->rotation_speed = -2.0f;
-	planets[5]->orbit_anchor = planets[4];
-	planets[5]->orbit_axis = glm::normalize(glm::vec3(0.8f, 0.0f, 1.0f));
-	planets[5]->orbit_radius = 10.0f;
-	planets[5]->orbit_speed = 2.0f;
-	planets[5]->orbit_offset = 0.0f;
-	planets[5]->light_source = planets[1];
-	planets[5]->rotation_axis = glm::normalize(glm::vec3(0.8f, 0.0f, 1.0f));
-	planets[5]->pole_axis = glm::normalize(glm::vec3(0.8f, 0.0f, 1.0f));
-	planets[5]->texture_path = "res/textures/4k_ceres_fictional.jpg";
-
-	planets[6]->name = "S1-P4";
+	planets[5]->radius = 2.0f;
+	planets[5]->mass = 2000.0f;
+	planets[5]->rotation_speed = 1.8f;
+	planets[5]->orbit_anchor = planets[0];
+	planets[5]->orbit_radius = 200.0f;
+	planets[5]->orbit_speed = 0.01f;
+	planets[5]->orbit_offset = 4.0f;
+	planets[5]->rotation_axis = glm::normalize(glm::vec3(0.0f, 0.8f, 1.0f));
+	planets[5]->pole_axis = glm::normalize(glm::vec3(0.0f, 0.8f, 1.0f));
+	planets[5]->orbit_axis = glm::normalize(glm::vec3(0.0f, 0.8f, 1.0f));
+	planets[5]->texture_path = "res/textures/2k_neptune.jpg";
+
+	planets[6]->name = "S1-P4-M1";
 	planets[6]->id = 6;
-	planets[6]->radius = 2.0f;
-	planets[6]->rotation_speed = 1.8f;
-	planets[6]->orbit_anchor = planets[1];
-	planets[6]->orbit_radius = 200.0f;
-	planets[6]->orbit_speed = 0.01f;
-	planets[6]->orbit_offset = 4.0f;
-	planets[6]->light_source = planets[1];
-	planets[6]->rotation_axis = glm::normalize(glm::vec3(0.0f, 0.8f, 1.0f));
-	planets[6]->pole_axis = glm::normalize(glm::vec3(0.0f, 0.8f, 1.0f));
-	planets[6]->orbit_axis = glm::normalize(glm::vec3(0.0f, 0.8f, 1.0f));
-	planets[6]->texture_path = "res/textures/2k_neptune.jpg";
-
-	planets[7]->name = "S1-P4-M1";
+	planets[6]->radius = 1.0f;
+	planets[6]->mass = 600.0f;
+	planets[6]->rotation_speed = 0.25f;
+	planets[6]->orbit_anchor = planets[5];
+	planets[6]->orbit_axis = glm::normalize(glm::vec3(2.0f, 0.0f, 1.0f));
+	planets[6]->orbit_radius = 40.0f;
+	planets[6]->orbit_speed = 0.2f;
+	planets[6]->orbit_offset = 5.0f;
+	planets[6]->rotation_axis = glm::normalize(glm::vec3(2.0f, 0.0f, 1.0f));
+	planets[6]->pole_axis = glm::normalize(glm::vec3(2.0f, 0.0f, 1.0f));
+	planets[6]->texture_path = "res/textures/8k_mercury.jpg";
+
+	planets[7]->name = "S1-P4-M1-M1";
 	planets[7]->id = 7;
-	planets[7]->radius = 1.0f;
-	planets[7]->rotation_speed = 0.25f;
+	planets[7]->radius = 0.1f;
+	planets[7]->mass = 1.0f;
+	planets[7]->rotation_speed = -0.8f;
 	planets[7]->orbit_anchor = planets[6];
-	planets[7]->orbit_axis = glm::normalize(glm::vec3(2.0f, 0.0f, 1.0f));
-	planets[7]->orbit_radius = 40.0f;
-	planets[7]->orbit_speed = 0.2f;
-	planets[7]->orbit_offset = 5.0f;
-	planets[7]->light_source = planets[1];
-	planets[7]->rotation_axis = glm::normalize(glm::vec3(2.0f, 0.0f, 1.0f));
-	planets[7]->pole_axis = glm::normalize(glm::vec3(2.0f, 0.0f, 1.0f));
-	planets[7]->texture_path = "res/textures/8k_mercury.jpg";
-
-	planets[8]->name = "S1-P4-M1-M1";
-	planets[8]->id = 8;
-	planets[8]->radius = 0.1f;
-	planets[8]->rotation_speed = -0.8f;
-	planets[8]->orbit_anchor = planets[7];
-	planets[8]->orbit_axis = glm::normalize(glm::vec3(0.0f, 0.2f, 1.0f));
-	planets[8]->orbit_radius = 4.0f;
-	planets[8]->orbit_speed = 0.8f;
-	planets[8]->orbit_offset = 1.0f;
-	planets[8]->light_source = planets[1];
-	planets[8]->rotation_axis = glm::normalize(glm::vec3(0.0f, 0.2f, 1.0f));
-	planets[8]->pole_axis = glm::normalize(glm::vec3(0.0f, 0.2f, 1.0f));
-	planets[8]->texture_path = "res/textures/4k_makemake_fictional.jpg";
+	planets[7]->orbit_axis = glm::normalize(glm::vec3(0.0f, 0.2f, 1.0f));
+	planets[7]->orbit_radius = 4.0f;
+	planets[7]->orbit_speed = 0.8f;
+	planets[7]->orbit_offset = 1.0f;
+	planets[7]->rotation_axis = glm::normalize(glm::vec3(0.0f, 0.2f, 1.0f));
+	planets[7]->pole_axis = glm::normalize(glm::vec3(0.0f, 0.2f, 1.0f));
+	planets[7]->texture_path = "res/textures/4k_makemake_fictional.jpg";
 }
 
 void Solarsystem::generatePlanets()
 {
+	PROFILE_SCOPE("Solarsystem::generatePlanets");
+
 	for (int i = 0; i < planets.size(); i++)
 	{
 		planets[i]->compileShader();
@@ -137,22 +135,106 @@ void Solarsystem::generatePlanets()
 	}
 }
 
-void Solarsystem::updatePlanets(float delta_time)
+void Solarsystem::updatePlanets(SimulationState &state, float delta_time)
 {
+	PROFILE_SCOPE("Solarsystem::updatePlanets");
+
+	if (ephemeris.isLoaded())
+		ephemeris.evaluate(state.time + delta_time);
+
 	for (int i = 0; i < planets.size(); i++)
 	{
-		planets[i]->updatePosition(delta_time);
-		planets[i]->updateRotation(delta_time);
+		// integrated bodies already moved, only the orbit lines still follow their anchors
+		if (planets[i]->ephemeris_index >= 0)
+		{
+			state.bodies[i].position = ephemeris.positions[planets[i]->ephemeris_index];
+			planets[i]->updateOrbitCenter(state);
+		}
+		else if (state.gravity)
+			planets[i]->updateOrbitCenter(state);
+		else
+			planets[i]->updatePosition(state, delta_time);
+		planets[i]->updateRotation(state, delta_time);
+	}
+}
+
+void Solarsystem::interpolatePlanets(const SimulationState &previous, const SimulationState &current, float alpha)
+{
+	PROFILE_SCOPE("Solarsystem::interpolatePlanets");
+
+	if (paused && previous.time == current.time && current.time == interpolated_time)
+		return;
+
+	// only a fully blended state counts as done, a pause mid blend still has to finish moving bodies onto current
+	interpolated_time = previous.time == current.time || alpha >= 1.0f ? current.time : -1.0;
+
+	for (int i = 0; i < planets.size(); i++)
+	{
+		planets[i]->applyState(previous.bodies[i], current.bodies[i], alpha);
 		planets[i]->updateModelMatrix();
 	}
 }
 
+void Solarsystem::updateBounds()
+{
+	PROFILE_SCOPE("Solarsystem::updateBounds");
+
+	bool rebuild = bvh.spheres.size() != planets.size();
+	bool moved = false;
+	bvh.spheres.resize(planets.size());
+	for (int i = 0; i < planets.size(); i++)
+	{
+		float radius = planets[i]->visible ? planets[i]->radius : 0.0f;
+		glm::vec4 sphere = glm::vec4(planets[i]->position, radius);
+		moved = moved || sphere != bvh.spheres[i];
+		bvh.spheres[i] = sphere;
+	}
+
+	// paused or stopped bodies leave the tree as it is
+	if (rebuild)
+		bvh.build();
+	else if (moved)
+		bvh.refit();
+}
+
+Planet *Solarsystem::pickPlanet(glm::vec3 origin, glm::vec3 direction)
+{
+	float distance;
+	int index = bvh.raycast(origin, direction, distance);
+	return index >= 0 ? planets[index] : nullptr;
+}
+
 void Solarsystem::drawPlanets()
 {
+	PROFILE_SCOPE("Solarsystem::drawPlanets");
+
+	gpu_timer.begin(GpuPass::BODIES);
 	for (int i = 0; i < planets.size(); i++)
 	{
-		planets[i]->drawBody();
+		if (camera.isVisible(planets[i]->position, planets[i]->radius))
+			planets[i]->drawBody();
+	}
+	gpu_timer.end(GpuPass::BODIES);
+
+	gpu_timer.begin(GpuPass::SKYBOX);
+	skybox.draw();
+	gpu_timer.end(GpuPass::SKYBOX);
+
+	gpu_timer.begin(GpuPass::STARS);
+	stars.draw();
+	gpu_timer.end(GpuPass::STARS);
+
+	gpu_timer.begin(GpuPass::ORBITS);
+	for (int i = 0; i < planets.size(); i++)
 		planets[i]->drawOrbit();
+	gpu_timer.end(GpuPass::ORBITS);
+
+	gpu_timer.begin(GpuPass::TRAILS);
+	trails.draw();
+	gpu_timer.end(GpuPass::TRAILS);
+
+	gpu_timer.begin(GpuPass::AXES);
+	for (int i = 0; i < planets.size(); i++)
 		planets[i]->drawAxis();
-	}
+	gpu_timer.end(GpuPass::AXES);
 }
\ No newline at end of file
@@ -1,18 +1,33 @@
 #pragma once
 
 #include "planet.h"
+#include "bvh.h"
+#include "ephemeris.h"
 
 #include <vector>
+#include <atomic>
 
 class Solarsystem
 {
 public:
 	std::vector<Planet*> planets;
-	float time_scale = 1.0f;
-	bool paused = false;
+	std::atomic<float> time_scale = 1.0f;
+	std::atomic<bool> paused = false;
+
+	// time of the last interpolated state, paused frames showing the same state skip the transforms entirely
+	double interpolated_time = -1.0;
+
+	// precomputed trajectories for the bodies that have a track, evaluated for all of them at once
+	Ephemeris ephemeris;
+
+	// bounding spheres of the interpolated bodies, refit every frame for picking
+	Bvh bvh;
 
 	void initializePlanets();
 	void generatePlanets();
-	void updatePlanets(float delta_time);
+	void updatePlanets(SimulationState &state, float delta_time);
+	void interpolatePlanets(const SimulationState &previous, const SimulationState &current, float alpha);
+	void updateBounds();
+	Planet *pickPlanet(glm::vec3 origin, glm::vec3 direction);
 	void drawPlanets();
 };
\ No newline at end of file
@@ -0,0 +1,158 @@
+#include "stars.h"
+#include "mapped_file.h"
+#include "global.h"
+#include "profiler.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cstddef>
+#include <cmath>
+
+void Stars::initialize()
+{
+	if (!loadCatalog())
+		return;
+
+	compileShader();
+	enabled = true;
+}
+
+void Stars::compileShader()
+{
+	const char *vert_source;
+
+	std::ifstream vert_file(shader_path + ".vs");
+	std::string vert_string((std::istreambuf_iterator<char>(vert_file)), std::istreambuf_iterator<char>());
+	vert_source = vert_string.c_str();
+
+	unsigned int vert_shader;
+	vert_shader = glCreateShader(GL_VERTEX_SHADER);
+
+	glShaderSource(vert_shader, 1, &vert_source, NULL);
+	glCompileShader(vert_shader);
+
+	const char *frag_source;
+
+	std::ifstream frag_file(shader_path + ".fs");
+	std::string frag_string((std::istreambuf_iterator<char>(frag_file)), std::istreambuf_iterator<char>());
+	frag_source = frag_string.c_str();
+
+	unsigned int frag_shader;
+	frag_shader = glCreateShader(GL_FRAGMENT_SHADER);
+
+	glShaderSource(frag_shader, 1, &frag_source, NULL);
+	glCompileShader(frag_shader);
+
+	shader = glCreateProgram();
+
+	glAttachShader(shader, vert_shader);
+	glAttachShader(shader, frag_shader);
+	glLinkProgram(shader);
+
+	glDeleteShader(vert_shader);
+	glDeleteShader(frag_shader);
+}
+
+bool Stars::loadCatalog()
+{
+	PROFILE_SCOPE("Stars::loadCatalog");
+
+	MappedFile file;
+	if (!file.open(catalog_path))
+	{
+		std::cout << "no star catalog at " << catalog_path << ", using the sky texture\n";
+		return false;
+	}
+
+	StarCatalogHeader header;
+	StarCatalogHeader expected;
+	if (file.size >= sizeof(header))
+		memcpy(&header, file.data, sizeof(header));
+	if (file.size < sizeof(header) || memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0 || header.version != expected.version ||
+		header.header_size != sizeof(StarCatalogHeader) || header.star_size != sizeof(StarEntry) || header.star_count == 0 ||
+		header.star_count > (file.size - header.header_size) / header.star_size)
+	{
+		std::cout << "not a valid star catalog: " << catalog_path << "\n";
+		return false;
+	}
+
+	// the mapped entries go to the gpu as they are, immutable storage since they never change
+	const StarEntry *entries = (const StarEntry *)(file.data + header.header_size);
+	size_t count = (size_t)header.star_count;
+
+	glGenVertexArrays(1, &vao);
+	glGenBuffers(1, &vbo);
+	glBindVertexArray(vao);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBufferStorage(GL_ARRAY_BUFFER, count * sizeof(StarEntry), entries, 0);
+
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(StarEntry), (void *)offsetof(StarEntry, direction));
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, sizeof(StarEntry), (void *)offsetof(StarEntry, magnitude));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(StarEntry), (void *)offsetof(StarEntry, color));
+	glEnableVertexAttribArray(2);
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+
+	magnitudes.resize(count);
+	for (size_t i = 0; i < count; i++)
+		magnitudes[i] = entries[i].magnitude;
+
+	std::cout << "loaded star catalog: " << catalog_path << ", " << count << " stars, " << count * sizeof(StarEntry) / 1024 << " KB\n";
+	return true;
+}
+
+float Stars::getLimitMagnitude()
+{
+	return limit_magnitude + 5.0f * std::log10(reference_fov / camera.fov);
+}
+
+void Stars::draw()
+{
+	if (!enabled)
+		return;
+
+	PROFILE_SCOPE("Stars::draw");
+
+	// everything fainter than the limit is past the end of the drawn prefix
+	float limit = getLimitMagnitude();
+	drawn = (int)(std::upper_bound(magnitudes.begin(), magnitudes.end(), limit) - magnitudes.begin());
+	if (drawn == 0)
+		return;
+
+	// rotation only, the stars sit at infinity
+	glm::mat4 view_projection = camera.projection * glm::mat4(glm::mat3(camera.view));
+
+	glUseProgram(shader);
+	glUniformMatrix4fv(glGetUniformLocation(shader, "view_projection"), 1, GL_FALSE, glm::value_ptr(view_projection));
+	glUniform1f(glGetUniformLocation(shader, "limit_magnitude"), limit);
+	glUniform1f(glGetUniformLocation(shader, "point_scale"), point_scale);
+	glUniform1f(glGetUniformLocation(shader, "max_point_size"), max_point_size);
+
+	// additive so overlapping sprites add up to a brighter spot instead of hiding each other
+	glEnable(GL_PROGRAM_POINT_SIZE);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+	glDepthFunc(GL_LEQUAL);
+	glDepthMask(GL_FALSE);
+	glBindVertexArray(vao);
+
+	glDrawArrays(GL_POINTS, 0, drawn);
+	stats.countDraw(0);
+
+	glBindVertexArray(0);
+	glDepthMask(GL_TRUE);
+	glDepthFunc(GL_LESS);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glDisable(GL_PROGRAM_POINT_SIZE);
+	glUseProgram(0);
+}
\ No newline at end of file
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+// entries are sorted brightest first, so the stars above any magnitude limit are a prefix of the buffer
+#pragma pack(push, 1)
+struct StarCatalogHeader
+{
+	char magic[4] = {'H', 'S', 'T', 'R'};
+	uint32_t version = 1;
+	uint32_t header_size = sizeof(StarCatalogHeader);
+	uint32_t star_size = 0;
+	uint64_t star_count = 0;
+};
+
+struct StarEntry
+{
+	glm::vec3 direction = glm::vec3(0.0f, 0.0f, 1.0f);
+	float magnitude = 0.0f;
+	uint8_t color[4] = {255, 255, 255, 255};
+};
+#pragma pack(pop)
+
+class Stars
+{
+public:
+	bool enabled = false;
+	std::string catalog_path = "res/stars/catalog.hstr";
+	std::string shader_path = "res/shaders/stars";
+
+	// faintest magnitude drawn at the reference field of view, narrower views reach deeper like a larger aperture
+	float limit_magnitude = 6.5f;
+	float reference_fov = 90.0f;
+	float point_scale = 1.5f;
+	float max_point_size = 10.0f;
+
+	GLuint shader = 0;
+	GLuint vao = 0;
+	GLuint vbo = 0;
+
+	// kept for picking the drawn prefix, the entries themselves only live on the gpu
+	std::vector<float> magnitudes;
+	int drawn = 0;
+
+	void initialize();
+	void compileShader();
+	bool loadCatalog();
+	float getLimitMagnitude();
+	void draw();
+};
\ No newline at end of file
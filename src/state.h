@@ -0,0 +1,31 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <chrono>
+#include <cstdint>
+
+struct BodyState
+{
+	glm::vec3 position = glm::vec3(0.0f);
+	glm::vec3 orbit_center = glm::vec3(0.0f);
+	float orbit_offset = 0.0f;
+	float rotation_offset = 0.0f;
+	float orbit_speed = 0.0f;
+	float radius = 1.0f;
+	bool active = true;
+
+	// only integrated in gravity mode, scripted orbits ignore them
+	glm::vec3 velocity = glm::vec3(0.0f);
+	float mass = 1.0f;
+};
+
+struct SimulationState
+{
+	std::vector<BodyState> bodies;
+	double time = 0.0;
+	uint64_t step = 0;
+	bool gravity = false;
+	std::chrono::steady_clock::time_point published;
+};
\ No newline at end of file
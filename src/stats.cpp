@@ -0,0 +1,88 @@
+#include "stats.h"
+#include "arena.h"
+
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+
+void Stats::beginFrame(float delta_time)
+{
+	frame_times[frame_count % window] = delta_time * 1000.0f;
+	frame_count += 1;
+
+	draw_calls = 0;
+	triangles = 0;
+	bodies = 0;
+
+	uint64_t thread_count = getThreadAllocationCount();
+	uint64_t process_count = getAllocationCount();
+	allocations = thread_count - allocation_start;
+	process_allocations = process_count - process_allocation_start;
+	allocation_start = thread_count;
+	process_allocation_start = process_count;
+}
+
+void Stats::beginSection(Section section)
+{
+	section_starts[(int)section] = std::chrono::steady_clock::now();
+}
+
+void Stats::endSection(Section section)
+{
+	float time = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - section_starts[(int)section]).count();
+	section_times[(int)section] += (time - section_times[(int)section]) * 0.05f;
+}
+
+void Stats::countDraw(int triangles)
+{
+	draw_calls += 1;
+	this->triangles += triangles;
+}
+
+void Stats::updatePercentiles()
+{
+	int count = std::min(frame_count, window);
+	if (count == 0)
+		return;
+
+	std::copy(frame_times, frame_times + count, sorted_times);
+
+	// nth_element on successively smaller tails, each percentile only partially orders what is left
+	int i50 = (count - 1) * 50 / 100;
+	int i95 = (count - 1) * 95 / 100;
+	int i99 = (count - 1) * 99 / 100;
+	std::nth_element(sorted_times, sorted_times + i50, sorted_times + count);
+	std::nth_element(sorted_times + i50, sorted_times + i95, sorted_times + count);
+	std::nth_element(sorted_times + i95, sorted_times + i99, sorted_times + count);
+
+	p50 = sorted_times[i50];
+	p95 = sorted_times[i95];
+	p99 = sorted_times[i99];
+	max = *std::max_element(sorted_times + i99, sorted_times + count);
+
+	// bins span up to twice the median so a steady frame rate sits mid-histogram and spikes pile up at the end
+	histogram_range = std::max(p50 * 2.0f, 1.0f);
+	histogram_peak = 0;
+	std::fill(histogram, histogram + bins, 0);
+	for (int i = 0; i < count; i++)
+	{
+		int bin = std::min((int)(frame_times[i] / histogram_range * bins), bins - 1);
+		histogram[bin] += 1;
+		histogram_peak = std::max(histogram_peak, histogram[bin]);
+	}
+}
+
+const char *Stats::getSectionName(Section section)
+{
+	switch (section)
+	{
+	case Section::UPDATE:
+		return "update";
+	case Section::DRAW:
+		return "draw";
+	case Section::UI:
+		return "ui";
+	default:
+		return "";
+	}
+}
\ No newline at end of file
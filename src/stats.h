@@ -0,0 +1,53 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+enum class Section
+{
+	UPDATE,
+	DRAW,
+	UI,
+	COUNT
+};
+
+class Stats
+{
+public:
+	static constexpr int window = 512;
+	static constexpr int bins = 64;
+	static constexpr int section_count = (int)Section::COUNT;
+
+	float frame_times[window] = {};
+	float sorted_times[window] = {};
+	int frame_count = 0;
+
+	float p50 = 0.0f;
+	float p95 = 0.0f;
+	float p99 = 0.0f;
+	float max = 0.0f;
+
+	int histogram[bins] = {};
+	int histogram_peak = 0;
+	float histogram_range = 0.0f;
+
+	float section_times[section_count] = {};
+	std::chrono::steady_clock::time_point section_starts[section_count];
+
+	int draw_calls = 0;
+	int triangles = 0;
+	int bodies = 0;
+
+	// heap allocations made during the last frame, by the render thread and by the whole process
+	uint64_t allocations = 0;
+	uint64_t process_allocations = 0;
+	uint64_t allocation_start = 0;
+	uint64_t process_allocation_start = 0;
+
+	void beginFrame(float delta_time);
+	void beginSection(Section section);
+	void endSection(Section section);
+	void countDraw(int triangles);
+	void updatePercentiles();
+	const char *getSectionName(Section section);
+};
\ No newline at end of file
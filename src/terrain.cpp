@@ -0,0 +1,617 @@
+#include "terrain.h"
+#include "arena.h"
+#include "global.h"
+#include "profiler.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <algorithm>
+#include <cmath>
+
+static const double pi = 3.14159265358979323846;
+
+// outward normal, then the two axes the face coordinates run along, their cross product is the normal so every face winds the same way
+static const glm::dvec3 face_axes[6][3] = {
+	{glm::dvec3(1, 0, 0), glm::dvec3(0, 1, 0), glm::dvec3(0, 0, 1)},
+	{glm::dvec3(-1, 0, 0), glm::dvec3(0, 0, 1), glm::dvec3(0, 1, 0)},
+	{glm::dvec3(0, 1, 0), glm::dvec3(0, 0, 1), glm::dvec3(1, 0, 0)},
+	{glm::dvec3(0, -1, 0), glm::dvec3(1, 0, 0), glm::dvec3(0, 0, 1)},
+	{glm::dvec3(0, 0, 1), glm::dvec3(1, 0, 0), glm::dvec3(0, 1, 0)},
+	{glm::dvec3(0, 0, -1), glm::dvec3(0, 1, 0), glm::dvec3(1, 0, 0)},
+};
+
+static const double gradients[12][3] = {
+	{1, 1, 0}, {-1, 1, 0}, {1, -1, 0}, {-1, -1, 0},
+	{1, 0, 1}, {-1, 0, 1}, {1, 0, -1}, {-1, 0, -1},
+	{0, 1, 1}, {0, -1, 1}, {0, 1, -1}, {0, -1, -1},
+};
+
+static double getGradient(int64_t x, int64_t y, int64_t z, uint32_t seed, glm::dvec3 offset)
+{
+	uint64_t hash = (uint64_t)x * 0x9E3779B97F4A7C15ull ^ (uint64_t)y * 0xC2B2AE3D27D4EB4Full ^ (uint64_t)z * 0x165667B19E3779F9ull ^ seed;
+	hash ^= hash >> 29;
+	hash *= 0xBF58476D1CE4E5B9ull;
+	hash ^= hash >> 32;
+
+	const double *gradient = gradients[hash % 12];
+	return gradient[0] * offset.x + gradient[1] * offset.y + gradient[2] * offset.z;
+}
+
+// gradient noise in double, the finest octaves sample it millions of cells away from the origin
+static double getNoise(glm::dvec3 point, uint32_t seed)
+{
+	glm::dvec3 cell = glm::floor(point);
+	glm::dvec3 f = point - cell;
+	glm::dvec3 w = f * f * f * (f * (f * 6.0 - 15.0) + 10.0);
+	int64_t x = (int64_t)cell.x;
+	int64_t y = (int64_t)cell.y;
+	int64_t z = (int64_t)cell.z;
+
+	double c000 = getGradient(x, y, z, seed, f);
+	double c100 = getGradient(x + 1, y, z, seed, f - glm::dvec3(1, 0, 0));
+	double c010 = getGradient(x, y + 1, z, seed, f - glm::dvec3(0, 1, 0));
+	double c110 = getGradient(x + 1, y + 1, z, seed, f - glm::dvec3(1, 1, 0));
+	double c001 = getGradient(x, y, z + 1, seed, f - glm::dvec3(0, 0, 1));
+	double c101 = getGradient(x + 1, y, z + 1, seed, f - glm::dvec3(1, 0, 1));
+	double c011 = getGradient(x, y + 1, z + 1, seed, f - glm::dvec3(0, 1, 1));
+	double c111 = getGradient(x + 1, y + 1, z + 1, seed, f - glm::dvec3(1, 1, 1));
+
+	double c00 = glm::mix(c000, c100, w.x);
+	double c10 = glm::mix(c010, c110, w.x);
+	double c01 = glm::mix(c001, c101, w.x);
+	double c11 = glm::mix(c011, c111, w.x);
+	return glm::mix(glm::mix(c00, c10, w.y), glm::mix(c01, c11, w.y), w.z);
+}
+
+// vector from the body to the camera, exact for the anchor since the offset is what the camera actually stores
+static glm::dvec3 getCameraOffset(Planet *planet)
+{
+	if (camera.anchor == planet)
+		return glm::dvec3(camera.offset);
+	return glm::dvec3(camera.position) - glm::dvec3(planet->position);
+}
+
+void Terrain::initialize()
+{
+	compileShader();
+	generateIndices();
+
+	// texcoords are unwrapped per chunk, so chunks across the date line read past 1 and need to wrap around
+	glGenSamplers(1, &sampler);
+	glSamplerParameteri(sampler, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glSamplerParameteri(sampler, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glSamplerParameteri(sampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glSamplerParameteri(sampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
+
+void Terrain::compileShader()
+{
+	const char *vert_source;
+
+	std::ifstream vert_file(vert_shader_path);
+	std::string vert_string((std::istreambuf_iterator<char>(vert_file)), std::istreambuf_iterator<char>());
+	vert_source = vert_string.c_str();
+
+	unsigned int vert_shader;
+	vert_shader = glCreateShader(GL_VERTEX_SHADER);
+
+	glShaderSource(vert_shader, 1, &vert_source, NULL);
+	glCompileShader(vert_shader);
+
+	const char *frag_source;
+
+	std::ifstream frag_file(frag_shader_path);
+	std::string frag_string((std::istreambuf_iterator<char>(frag_file)), std::istreambuf_iterator<char>());
+	frag_source = frag_string.c_str();
+
+	unsigned int frag_shader;
+	frag_shader = glCreateShader(GL_FRAGMENT_SHADER);
+
+	glShaderSource(frag_shader, 1, &frag_source, NULL);
+	glCompileShader(frag_shader);
+
+	shader = glCreateProgram();
+
+	glAttachShader(shader, vert_shader);
+	glAttachShader(shader, frag_shader);
+	glLinkProgram(shader);
+
+	glDeleteShader(vert_shader);
+	glDeleteShader(frag_shader);
+}
+
+void Terrain::generateIndices()
+{
+	// the same grid for every chunk, vertices come from each chunk's storage buffer by index
+	std::vector<unsigned int> indices;
+	indices.reserve(grid * grid * 6);
+	for (int j = 0; j < grid; j++)
+	{
+		for (int i = 0; i < grid; i++)
+		{
+			unsigned int a = j * (grid + 1) + i;
+			unsigned int b = a + 1;
+			unsigned int c = a + grid + 1;
+			unsigned int d = c + 1;
+			indices.insert(indices.end(), {a, b, d, a, d, c});
+		}
+	}
+	index_count = (int)indices.size();
+
+	glGenVertexArrays(1, &vao);
+	glGenBuffers(1, &ebo);
+	glBindVertexArray(vao);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+	glBufferStorage(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), 0);
+	glBindVertexArray(0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+void Terrain::update()
+{
+	PROFILE_SCOPE("Terrain::update");
+
+	frame += 1;
+	uploaded_this_frame = 0;
+	drawn_chunks = 0;
+
+	std::vector<Planet *> &planets = solarsystem.planets;
+	if (trees.size() < planets.size())
+		trees.resize(planets.size(), nullptr);
+
+	for (int i = 0; i < planets.size(); i++)
+	{
+		Planet *planet = planets[i];
+		TerrainTree *tree = trees[i];
+
+		// emitters keep their own shader, and anything small on screen is better served by the sphere
+		float pixels = camera.getPixelRadius(planet->position, planet->radius);
+		bool eligible = enabled && !planet->emitter && planet->visible;
+		if (!tree && eligible && pixels > activation_pixels)
+			tree = trees[i] = createTree(planet);
+
+		if (tree && (!eligible || pixels < activation_pixels * 0.5f))
+		{
+			// chunks still being generated are written to, the tree waits for them before it goes
+			tree->selected.clear();
+			if (tree->queued.load(std::memory_order_acquire) == 0)
+			{
+				destroyTree(tree);
+				trees[i] = nullptr;
+			}
+			continue;
+		}
+
+		if (tree)
+		{
+			selectChunks(tree);
+			updateEdges(tree);
+			for (int face = 0; face < 6; face++)
+				prune(tree->roots[face]);
+		}
+	}
+}
+
+void Terrain::selectChunks(TerrainTree *tree)
+{
+	Planet *planet = tree->planet;
+	tree->selected.clear();
+
+	// nothing is drawn until all six faces exist, the sphere mesh covers for them in the meantime
+	bool ready = true;
+	for (int face = 0; face < 6; face++)
+		ready = requestChunk(tree->roots[face]) && ready;
+	if (!ready)
+		return;
+
+	glm::dmat3 orientation = glm::dmat3(glm::mat3(planet->body_model)) / (double)planet->radius;
+	glm::dvec3 camera_position = glm::transpose(orientation) * getCameraOffset(planet) / (double)planet->radius;
+	double pixels_per_radian = camera.projection[1][1] * camera.resolution.y * 0.5;
+
+	// largest error first, so when the budget runs out it is the least visible detail that goes missing
+	int max_chunks = std::max(triangle_budget / (grid * grid * 2), 6);
+	int count = 6;
+	auto compare = [](TerrainChunk *a, TerrainChunk *b) { return a->error < b->error; };
+	FrameVector<TerrainChunk *> heap;
+	for (int face = 0; face < 6; face++)
+	{
+		updateChunk(tree->roots[face], camera_position, pixels_per_radian);
+		heap.push_back(tree->roots[face]);
+	}
+	std::make_heap(heap.begin(), heap.end(), compare);
+
+	while (!heap.empty())
+	{
+		std::pop_heap(heap.begin(), heap.end(), compare);
+		TerrainChunk *chunk = heap.back();
+		heap.pop_back();
+		chunk->visited_frame = frame;
+
+		if (chunk->visible && chunk->error > pixel_error && chunk->depth < max_depth && count + 3 <= max_chunks)
+		{
+			if (!chunk->children[0])
+			{
+				glm::dvec2 middle = (chunk->lower + chunk->upper) * 0.5;
+				chunk->children[0] = createChunk(tree, chunk, chunk->face, chunk->lower, middle);
+				chunk->children[1] = createChunk(tree, chunk, chunk->face, glm::dvec2(middle.x, chunk->lower.y), glm::dvec2(chunk->upper.x, middle.y));
+				chunk->children[2] = createChunk(tree, chunk, chunk->face, glm::dvec2(chunk->lower.x, middle.y), glm::dvec2(middle.x, chunk->upper.y));
+				chunk->children[3] = createChunk(tree, chunk, chunk->face, middle, chunk->upper);
+			}
+
+			// a chunk is only replaced once all four children can be drawn, until then it stands in for them
+			bool children_ready = true;
+			for (int i = 0; i < 4; i++)
+			{
+				chunk->children[i]->visited_frame = frame;
+				children_ready = requestChunk(chunk->children[i]) && children_ready;
+			}
+
+			if (children_ready)
+			{
+				count += 3;
+				for (int i = 0; i < 4; i++)
+				{
+					updateChunk(chunk->children[i], camera_position, pixels_per_radian);
+					heap.push_back(chunk->children[i]);
+					std::push_heap(heap.begin(), heap.end(), compare);
+				}
+				continue;
+			}
+		}
+
+		chunk->selected_frame = frame;
+		tree->selected.push_back(chunk);
+	}
+}
+
+void Terrain::updateChunk(TerrainChunk *chunk, glm::dvec3 camera_position, double pixels_per_radian)
+{
+	Planet *planet = chunk->tree->planet;
+	glm::vec3 world_center = planet->position + glm::mat3(planet->body_model) * glm::vec3(chunk->center);
+	chunk->visible = camera.isVisible(world_center, (float)(chunk->bound * planet->radius));
+
+	// past the horizon of the lowest possible ground, allowing for the highest peaks still poking over it
+	double distance = glm::length(camera_position);
+	double lowest = 1.0 - height_scale;
+	if (chunk->visible && distance > lowest)
+	{
+		double horizon = std::acos(lowest / distance) + std::acos(lowest / (1.0 + height_scale));
+		double angle = std::acos(glm::clamp(glm::dot(chunk->center, camera_position / distance), -1.0, 1.0));
+		chunk->visible = angle - chunk->angle <= horizon;
+	}
+
+	// projected spacing between the chunk's vertices at its nearest point
+	double spacing = 2.0 * chunk->angle / std::sqrt(2.0) / grid;
+	double nearest = std::max(glm::length(camera_position - chunk->center) - chunk->bound, 1e-9);
+	chunk->error = chunk->visible ? (float)(spacing / nearest * pixels_per_radian) : 0.0f;
+}
+
+bool Terrain::requestChunk(TerrainChunk *chunk)
+{
+	if (chunk->state == ChunkState::EMPTY && (!asynchronous || queued < max_queued))
+	{
+		queued += 1;
+		chunk->tree->queued += 1;
+		chunk->state = ChunkState::QUEUED;
+		if (asynchronous)
+			jobs.submit([this, chunk] { generateChunk(chunk); });
+		else
+			generateChunk(chunk);
+	}
+
+	// generated on a worker, but the buffer can only be made here on the render thread
+	if (chunk->state.load(std::memory_order_acquire) == ChunkState::GENERATED && (!asynchronous || uploaded_this_frame < max_uploads))
+	{
+		uploaded_this_frame += 1;
+		uploadChunk(chunk);
+	}
+	return chunk->state == ChunkState::UPLOADED;
+}
+
+void Terrain::generateChunk(TerrainChunk *chunk)
+{
+	PROFILE_SCOPE("Terrain::generateChunk");
+
+	// one ring of extra samples around the grid, so normals on the edges match the neighbouring chunks
+	int size = grid + 3;
+	FrameVector<glm::dvec3> points(size * size);
+	glm::dvec2 extent = chunk->upper - chunk->lower;
+	for (int j = 0; j < size; j++)
+	{
+		for (int i = 0; i < size; i++)
+		{
+			glm::dvec2 coords = chunk->lower + extent * glm::dvec2(i - 1, j - 1) / (double)grid;
+			glm::dvec3 direction = getDirection(chunk->face, coords);
+			points[j * size + i] = direction * (1.0 + getHeight(direction, chunk->tree->seed));
+		}
+	}
+
+	double center_u = std::atan2(chunk->center.y, chunk->center.x) / (2.0 * pi);
+
+	chunk->vertices.resize((grid + 1) * (grid + 1));
+	for (int j = 0; j <= grid; j++)
+	{
+		for (int i = 0; i <= grid; i++)
+		{
+			int index = (j + 1) * size + i + 1;
+			glm::dvec3 point = points[index];
+			glm::dvec3 along_u = points[index + 1] - points[index - 1];
+			glm::dvec3 along_v = points[index + size] - points[index - size];
+			glm::dvec3 normal = glm::normalize(glm::cross(along_u, along_v));
+
+			// same mapping as the sphere mesh, unwrapped around the chunk center so it never jumps across the seam
+			glm::dvec3 direction = glm::normalize(point);
+			double u = std::atan2(direction.y, direction.x) / (2.0 * pi);
+			u += std::round(center_u - u);
+			double v = std::acos(glm::clamp(direction.z, -1.0, 1.0)) / pi;
+
+			TerrainVertex &vertex = chunk->vertices[j * (grid + 1) + i];
+			vertex.position = glm::vec4(glm::vec3(point - chunk->center), (float)u);
+			vertex.normal = glm::vec4(glm::vec3(normal), (float)v);
+		}
+	}
+
+	// once the state is stored the chunk may be pruned, and once the tree count drops the whole tree may be freed, so that goes last
+	TerrainTree *tree = chunk->tree;
+	queued -= 1;
+	chunk->state.store(ChunkState::GENERATED, std::memory_order_release);
+	tree->queued.fetch_sub(1, std::memory_order_release);
+}
+
+void Terrain::uploadChunk(TerrainChunk *chunk)
+{
+	glGenBuffers(1, &chunk->buffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, chunk->buffer);
+	glBufferStorage(GL_SHADER_STORAGE_BUFFER, chunk->vertices.size() * sizeof(TerrainVertex), chunk->vertices.data(), 0);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	std::vector<TerrainVertex>().swap(chunk->vertices);
+	chunk->state = ChunkState::UPLOADED;
+	chunk_count += 1;
+}
+
+void Terrain::updateEdges(TerrainTree *tree)
+{
+	// a chunk next to a coarser one drops the in between vertices of that edge onto the coarser grid
+	for (int k = 0; k < tree->selected.size(); k++)
+	{
+		TerrainChunk *chunk = tree->selected[k];
+		glm::dvec2 middle = (chunk->lower + chunk->upper) * 0.5;
+		double outside = (chunk->upper.x - chunk->lower.x) * 0.01;
+
+		glm::dvec2 probes[4] = {
+			glm::dvec2(middle.x, chunk->lower.y - outside),
+			glm::dvec2(chunk->upper.x + outside, middle.y),
+			glm::dvec2(middle.x, chunk->upper.y + outside),
+			glm::dvec2(chunk->lower.x - outside, middle.y),
+		};
+
+		for (int edge = 0; edge < 4; edge++)
+		{
+			TerrainChunk *neighbour = findSelected(tree, getDirection(chunk->face, probes[edge]));
+			int levels = glm::clamp(chunk->depth - neighbour->depth, 0, 5);
+			chunk->edge_steps[edge] = std::min(1 << levels, grid);
+		}
+	}
+}
+
+TerrainChunk *Terrain::findSelected(TerrainTree *tree, glm::dvec3 direction)
+{
+	glm::dvec2 coords;
+	TerrainChunk *chunk = tree->roots[locate(direction, coords)];
+	while (chunk->selected_frame != frame && chunk->children[0])
+	{
+		glm::dvec2 middle = (chunk->lower + chunk->upper) * 0.5;
+		chunk = chunk->children[(coords.x >= middle.x ? 1 : 0) + (coords.y >= middle.y ? 2 : 0)];
+	}
+	return chunk;
+}
+
+bool Terrain::draw(Planet *planet)
+{
+	if (planet->id >= trees.size() || !trees[planet->id] || trees[planet->id]->selected.empty())
+		return false;
+
+	PROFILE_SCOPE("Terrain::draw");
+
+	TerrainTree *tree = trees[planet->id];
+	glm::mat3 rotation = glm::mat3(planet->body_model);
+	glm::dmat3 orientation = glm::dmat3(rotation);
+	glm::dvec3 planet_offset = -getCameraOffset(planet);
+	glm::mat3 view_rotation = glm::mat3(camera.view);
+
+	// positions reach the shader relative to the camera, so they keep their precision right down at the ground
+	planet->setBodyUniforms(shader);
+	glUseProgram(shader);
+	glUniformMatrix3fv(glGetUniformLocation(shader, "rotation"), 1, GL_FALSE, glm::value_ptr(rotation));
+	glUniformMatrix3fv(glGetUniformLocation(shader, "view_rotation"), 1, GL_FALSE, glm::value_ptr(view_rotation));
+	glUniformMatrix4fv(glGetUniformLocation(shader, "projection"), 1, GL_FALSE, glm::value_ptr(camera.projection));
+	glUniform1i(glGetUniformLocation(shader, "grid"), grid);
+	GLint chunk_offset_location = glGetUniformLocation(shader, "chunk_offset");
+	GLint edge_steps_location = glGetUniformLocation(shader, "edge_steps");
+
+	lighting.bind();
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, textures.use(planet->texture_id, camera.getPixelRadius(planet->position, planet->radius)));
+	glBindSampler(0, sampler);
+	glBindVertexArray(vao);
+
+	for (int i = 0; i < tree->selected.size(); i++)
+	{
+		TerrainChunk *chunk = tree->selected[i];
+		if (!chunk->visible)
+			continue;
+
+		glm::vec3 chunk_offset = glm::vec3(planet_offset + orientation * chunk->center);
+		glUniform3fv(chunk_offset_location, 1, glm::value_ptr(chunk_offset));
+		glUniform4iv(edge_steps_location, 1, glm::value_ptr(chunk->edge_steps));
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, chunk->buffer);
+
+		glDrawElements(GL_TRIANGLES, index_count, GL_UNSIGNED_INT, (void *)0);
+		stats.countDraw(index_count / 3);
+		drawn_chunks += 1;
+	}
+	stats.bodies += 1;
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, 0);
+	glBindVertexArray(0);
+	glBindSampler(0, 0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glUseProgram(0);
+	return true;
+}
+
+float Terrain::getNearPlane(float near_plane, float min_near_plane)
+{
+	// half the height above the closest ground, so flying low does not clip the surface right below
+	for (int i = 0; i < trees.size(); i++)
+	{
+		if (!trees[i] || trees[i]->selected.empty())
+			continue;
+
+		Planet *planet = trees[i]->planet;
+		glm::dvec3 offset = getCameraOffset(planet);
+		double distance = std::max(glm::length(offset), 1e-30);
+		glm::dmat3 orientation = glm::dmat3(glm::mat3(planet->body_model)) / (double)planet->radius;
+		glm::dvec3 direction = glm::transpose(orientation) * offset / distance;
+		double altitude = distance - planet->radius * (1.0 + getHeight(direction, trees[i]->seed));
+		near_plane = std::min(near_plane, (float)(altitude * 0.5));
+	}
+	return std::max(near_plane, min_near_plane);
+}
+
+double Terrain::getHeight(glm::dvec3 direction, uint32_t seed)
+{
+	double height = 0.0;
+	double amplitude = 1.0;
+	double total = 0.0;
+	double frequency = base_frequency;
+	for (int i = 0; i < octaves; i++)
+	{
+		// shifted per octave so the lattices of successive octaves never line up
+		height += getNoise(direction * frequency + glm::dvec3(i * 17.31, i * 9.77, i * 3.13), seed + i) * amplitude;
+		total += amplitude;
+		amplitude *= 0.5;
+		frequency *= 2.0;
+	}
+	return glm::clamp(height / total * 2.0, -1.0, 1.0) * height_scale;
+}
+
+glm::dvec3 Terrain::getDirection(int face, glm::dvec2 coords)
+{
+	// tangent warp spreads the vertices far more evenly over the sphere than the plain cube projection
+	glm::dvec2 warped = glm::tan(coords * (pi / 4.0));
+	const glm::dvec3 *axes = face_axes[face];
+	return glm::normalize(axes[0] + axes[1] * warped.x + axes[2] * warped.y);
+}
+
+int Terrain::locate(glm::dvec3 direction, glm::dvec2 &coords)
+{
+	glm::dvec3 magnitude = glm::abs(direction);
+	int axis = magnitude.x >= magnitude.y && magnitude.x >= magnitude.z ? 0 : (magnitude.y >= magnitude.z ? 1 : 2);
+	int face = axis * 2 + (direction[axis] < 0.0 ? 1 : 0);
+
+	const glm::dvec3 *axes = face_axes[face];
+	glm::dvec3 projected = direction / magnitude[axis];
+	coords = glm::dvec2(std::atan(glm::dot(projected, axes[1])), std::atan(glm::dot(projected, axes[2]))) * (4.0 / pi);
+	return face;
+}
+
+TerrainTree *Terrain::createTree(Planet *planet)
+{
+	TerrainTree *tree = new TerrainTree;
+	tree->planet = planet;
+	tree->seed = 0x5EED0000u + planet->id * 7919u;
+	for (int face = 0; face < 6; face++)
+		tree->roots[face] = createChunk(tree, nullptr, face, glm::dvec2(-1.0), glm::dvec2(1.0));
+	return tree;
+}
+
+void Terrain::destroyTree(TerrainTree *tree)
+{
+	for (int face = 0; face < 6; face++)
+		destroyChunk(tree->roots[face]);
+	delete tree;
+}
+
+TerrainChunk *Terrain::createChunk(TerrainTree *tree, TerrainChunk *parent, int face, glm::dvec2 lower, glm::dvec2 upper)
+{
+	TerrainChunk *chunk = new TerrainChunk;
+	chunk->tree = tree;
+	chunk->parent = parent;
+	chunk->face = face;
+	chunk->depth = parent ? parent->depth + 1 : 0;
+	chunk->lower = lower;
+	chunk->upper = upper;
+	chunk->center = getDirection(face, (lower + upper) * 0.5);
+
+	// corners are the farthest points, at the lowest or highest the terrain can reach
+	glm::dvec2 corners[4] = {lower, glm::dvec2(upper.x, lower.y), glm::dvec2(lower.x, upper.y), upper};
+	chunk->bound = height_scale;
+	for (int i = 0; i < 4; i++)
+	{
+		glm::dvec3 corner = getDirection(face, corners[i]);
+		chunk->angle = std::max(chunk->angle, std::acos(glm::clamp(glm::dot(corner, chunk->center), -1.0, 1.0)));
+		chunk->bound = std::max(chunk->bound, glm::length(corner * (1.0 + height_scale) - chunk->center));
+		chunk->bound = std::max(chunk->bound, glm::length(corner * (1.0 - height_scale) - chunk->center));
+	}
+	return chunk;
+}
+
+void Terrain::destroyChunk(TerrainChunk *chunk)
+{
+	for (int i = 0; i < 4; i++)
+	{
+		if (chunk->children[i])
+			destroyChunk(chunk->children[i]);
+	}
+
+	if (chunk->buffer)
+	{
+		glDeleteBuffers(1, &chunk->buffer);
+		chunk_count -= 1;
+	}
+	delete chunk;
+}
+
+bool Terrain::isBusy(TerrainChunk *chunk)
+{
+	if (chunk->state == ChunkState::QUEUED)
+		return true;
+
+	for (int i = 0; i < 4; i++)
+	{
+		if (chunk->children[i] && isBusy(chunk->children[i]))
+			return true;
+	}
+	return false;
+}
+
+void Terrain::prune(TerrainChunk *chunk)
+{
+	if (!chunk->children[0])
+		return;
+
+	// children the selection has not come back to in a while go, unless a job is still filling one of them
+	bool unused = true;
+	for (int i = 0; i < 4; i++)
+		unused = unused && chunk->children[i]->visited_frame < frame - keep_frames;
+
+	if (unused && !isBusy(chunk->children[0]) && !isBusy(chunk->children[1]) && !isBusy(chunk->children[2]) && !isBusy(chunk->children[3]))
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			destroyChunk(chunk->children[i]);
+			chunk->children[i] = nullptr;
+		}
+		return;
+	}
+
+	for (int i = 0; i < 4; i++)
+		prune(chunk->children[i]);
+}
\ No newline at end of file
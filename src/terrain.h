@@ -0,0 +1,144 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <string>
+#include <atomic>
+#include <cstdint>
+
+class Planet;
+struct TerrainTree;
+
+// one vertex as the shader pulls it from the chunk's storage buffer, std430 so two vec4s.
+// the position is relative to the chunk center in the body's unit sphere frame, texcoords ride in the w components
+struct TerrainVertex
+{
+	glm::vec4 position = glm::vec4(0.0f);
+	glm::vec4 normal = glm::vec4(0.0f);
+};
+
+enum class ChunkState
+{
+	EMPTY,
+	QUEUED,
+	GENERATED,
+	UPLOADED
+};
+
+// quadtree node covering a square of one cube face, the face coordinates run from -1 to 1
+struct TerrainChunk
+{
+	TerrainTree *tree = nullptr;
+	TerrainChunk *parent = nullptr;
+	TerrainChunk *children[4] = {};
+
+	int face = 0;
+	int depth = 0;
+	glm::dvec2 lower = glm::dvec2(-1.0);
+	glm::dvec2 upper = glm::dvec2(1.0);
+
+	// on the unit sphere, the bound also covers the highest and lowest terrain the chunk can hold
+	glm::dvec3 center = glm::dvec3(0.0);
+	double bound = 0.0;
+	double angle = 0.0;
+
+	std::atomic<ChunkState> state = ChunkState::EMPTY;
+	std::vector<TerrainVertex> vertices;
+	GLuint buffer = 0;
+
+	// frame the selection last reached this chunk and whether it was drawn then, unused subtrees get pruned
+	int visited_frame = -1;
+	int selected_frame = -1;
+	float error = 0.0f;
+	bool visible = false;
+
+	// vertices per edge collapsed onto the neighbour's coarser grid, bottom, right, top, left
+	glm::ivec4 edge_steps = glm::ivec4(1);
+};
+
+struct TerrainTree
+{
+	Planet *planet = nullptr;
+	uint32_t seed = 0;
+	TerrainChunk *roots[6] = {};
+	std::vector<TerrainChunk *> selected;
+
+	// jobs still writing into chunks of this tree, it can only be freed once they are done
+	std::atomic<int> queued = 0;
+};
+
+// cube sphere quadtree terrain for bodies close enough to need more than the fixed sphere mesh.
+// chunks are refined by their projected vertex spacing, generated on the job threads and all drawn with one index grid
+class Terrain
+{
+public:
+	bool enabled = true;
+	// off for captures and replays, every chunk is then generated the moment it is needed so frames never differ
+	bool asynchronous = true;
+
+	// quads along a chunk edge, a power of two so coarser neighbours always line up with every other vertex
+	static constexpr int grid = 32;
+	int max_depth = 16;
+	float pixel_error = 4.0f;
+	int triangle_budget = 1000000;
+
+	// bodies switch to the quadtree above this many pixels of radius, and back below half of it
+	float activation_pixels = 150.0f;
+
+	// fractal height as a fraction of the radius, octaves reach down to the finest chunks
+	float height_scale = 0.004f;
+	int octaves = 22;
+	double base_frequency = 2.0;
+
+	// chunks waiting on or being generated by the job threads, kept low so other jobs do not queue behind them
+	int max_queued = 8;
+	int max_uploads = 16;
+	int keep_frames = 120;
+
+	std::string vert_shader_path = "res/shaders/planet_terrain.vs";
+	std::string frag_shader_path = "res/shaders/planet_body.fs";
+
+	GLuint shader = 0;
+	GLuint vao = 0;
+	GLuint ebo = 0;
+	GLuint sampler = 0;
+	int index_count = 0;
+
+	std::vector<TerrainTree *> trees;
+	int frame = 0;
+	int uploaded_this_frame = 0;
+
+	// for the performance page
+	int chunk_count = 0;
+	int drawn_chunks = 0;
+	std::atomic<int> queued = 0;
+
+	void initialize();
+	void compileShader();
+	void generateIndices();
+
+	void update();
+	bool draw(Planet *planet);
+	float getNearPlane(float near_plane, float min_near_plane);
+
+	double getHeight(glm::dvec3 direction, uint32_t seed);
+	static glm::dvec3 getDirection(int face, glm::dvec2 coords);
+	static int locate(glm::dvec3 direction, glm::dvec2 &coords);
+
+	TerrainTree *createTree(Planet *planet);
+	void destroyTree(TerrainTree *tree);
+	TerrainChunk *createChunk(TerrainTree *tree, TerrainChunk *parent, int face, glm::dvec2 lower, glm::dvec2 upper);
+	void destroyChunk(TerrainChunk *chunk);
+	bool isBusy(TerrainChunk *chunk);
+
+	void selectChunks(TerrainTree *tree);
+	void updateChunk(TerrainChunk *chunk, glm::dvec3 camera_position, double pixels_per_radian);
+	bool requestChunk(TerrainChunk *chunk);
+	void generateChunk(TerrainChunk *chunk);
+	void uploadChunk(TerrainChunk *chunk);
+	void updateEdges(TerrainTree *tree);
+	TerrainChunk *findSelected(TerrainTree *tree, glm::dvec3 direction);
+	void prune(TerrainChunk *chunk);
+};
\ No newline at end of file
@@ -0,0 +1,359 @@
+#include "textures.h"
+#include "global.h"
+#include "profiler.h"
+
+#include <glad/glad.h>
+#include <stb_image/stb_image.h>
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include <mutex>
+#include <algorithm>
+#include <cmath>
+
+void TextureManager::initialize()
+{
+	// drawn while a texture is evicted or still decoding
+	unsigned char grey[3] = {128, 128, 128};
+	glGenTextures(1, &fallback);
+	glBindTexture(GL_TEXTURE_2D, fallback);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, grey);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+int TextureManager::acquire(const std::string &path)
+{
+	// bodies sharing an image share one texture
+	for (int i = 0; i < entries.size(); i++)
+	{
+		if (entries[i].path == path)
+			return i;
+	}
+
+	// only the header is read here, so the first request already knows which level the body needs
+	TextureEntry entry;
+	entry.path = path;
+	int channels;
+	if (!stbi_info(path.c_str(), &entry.width, &entry.height, &channels))
+	{
+		entry.width = 0;
+		entry.height = 0;
+	}
+	entries.push_back(entry);
+	return (int)entries.size() - 1;
+}
+
+GLuint TextureManager::use(int id, float pixels)
+{
+	TextureEntry &entry = entries[id];
+	entry.last_used = frame;
+
+	if (entry.failed)
+		return fallback;
+
+	// the coarsest level that still gives a texel per pixel around the visible equator
+	int level = 0;
+	if (entry.width > 0)
+	{
+		float texels = entry.width / std::max(pixels * 2.0f * 3.1415926f, 1.0f);
+		level = std::max((int)std::floor(std::log2(texels)), 0);
+		while (level > 0 && (entry.width >> level) < min_width)
+			level -= 1;
+	}
+
+	// only ever load sharper on demand, dropping detail is left to budget pressure so nothing thrashes
+	if (!entry.loading && frame >= entry.retry_frame && (!entry.texture || level < entry.level))
+		request(id, level);
+
+	return entry.texture ? entry.texture : fallback;
+}
+
+void TextureManager::update()
+{
+	PROFILE_SCOPE("TextureManager::update");
+
+	std::vector<TextureLoad *> loads;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		loads.swap(finished);
+	}
+
+	for (int i = 0; i < loads.size(); i++)
+	{
+		upload(loads[i]);
+		delete loads[i];
+	}
+
+	frame += 1;
+}
+
+void TextureManager::request(int id, int level)
+{
+	TextureEntry &entry = entries[id];
+	entry.loading = true;
+
+	TextureLoad *load = new TextureLoad;
+	load->id = id;
+	load->level = level;
+	load->path = entry.path;
+
+	if (!asynchronous)
+	{
+		decode(load);
+		upload(load);
+		delete load;
+		return;
+	}
+
+	jobs.submit([this, load]
+	{
+		decode(load);
+		std::lock_guard<std::mutex> lock(mutex);
+		finished.push_back(load);
+	});
+}
+
+void TextureManager::decode(TextureLoad *load)
+{
+	PROFILE_SCOPE("TextureManager::decode");
+
+	// runs on the job workers, the thread local flag leaves the global one the render thread sets alone
+	int width, height, channels;
+	stbi_set_flip_vertically_on_load_thread(true);
+	unsigned char *data = stbi_load(load->path.c_str(), &width, &height, &channels, 3);
+	if (!data)
+		return;
+
+	load->source_width = width;
+	load->source_height = height;
+
+	// box filter down to the requested level on the worker, so the upload never allocates the full size
+	int level = std::min(load->level, getLevelCount(width, height) - 1);
+	int factor = 1 << level;
+	load->level = level;
+	load->width = std::max(width / factor, 1);
+	load->height = std::max(height / factor, 1);
+	load->pixels.resize((size_t)load->width * load->height * 3);
+
+	for (int y = 0; y < load->height; y++)
+	{
+		for (int x = 0; x < load->width; x++)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				int sum = 0;
+				for (int v = 0; v < factor; v++)
+					for (int u = 0; u < factor; u++)
+						sum += data[((size_t)(y * factor + v) * width + (x * factor + u)) * 3 + c];
+				load->pixels[((size_t)y * load->width + x) * 3 + c] = (unsigned char)(sum / (factor * factor));
+			}
+		}
+	}
+
+	stbi_image_free(data);
+}
+
+void TextureManager::upload(TextureLoad *load)
+{
+	PROFILE_SCOPE("TextureManager::upload");
+
+	TextureEntry &entry = entries[load->id];
+	entry.loading = false;
+
+	if (load->pixels.empty())
+	{
+		std::cout << "failed to load texture: " << entry.path << "\n";
+		entry.failed = true;
+		return;
+	}
+
+	entry.width = load->source_width;
+	entry.height = load->source_height;
+
+	// everything else is in view, settle for a coarser copy rather than break the ceiling
+	size_t current = entry.texture ? entry.bytes : 0;
+	size_t size = getTextureSize(load->width, load->height);
+	while (size > current && !makeRoom(size - current, load->id) && load->width > min_width)
+	{
+		halve(load);
+		size = getTextureSize(load->width, load->height);
+	}
+
+	// nothing sharper than what is resident fits, wait a while before decoding it again
+	if ((entry.texture && entry.level <= load->level) || bytes - current + size > budget)
+	{
+		entry.retry_frame = frame + grace_frames;
+		return;
+	}
+
+	evict(load->id);
+
+	GLuint texture;
+	glGenTextures(1, &texture);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexStorage2D(GL_TEXTURE_2D, getLevelCount(load->width, load->height), GL_RGB8, load->width, load->height);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, load->width, load->height, GL_RGB, GL_UNSIGNED_BYTE, load->pixels.data());
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glGenerateMipmap(GL_TEXTURE_2D);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	if (load->source_width < 256)
+	{
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	}
+	else
+	{
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	}
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	entry.texture = texture;
+	entry.level = load->level;
+	entry.bytes = size;
+	bytes += size;
+}
+
+void TextureManager::halve(TextureLoad *load)
+{
+	int width = std::max(load->width / 2, 1);
+	int height = std::max(load->height / 2, 1);
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				int sum = 0;
+				for (int v = 0; v < 2; v++)
+					for (int u = 0; u < 2; u++)
+						sum += load->pixels[((size_t)std::min(y * 2 + v, load->height - 1) * load->width + std::min(x * 2 + u, load->width - 1)) * 3 + c];
+				load->pixels[((size_t)y * width + x) * 3 + c] = (unsigned char)(sum / 4);
+			}
+		}
+	}
+
+	load->width = width;
+	load->height = height;
+	load->level += 1;
+	load->pixels.resize((size_t)width * height * 3);
+}
+
+bool TextureManager::makeRoom(size_t size, int keep)
+{
+	// give up before touching anything if even dropping every texture not yet drawn this frame wouldn't do
+	size_t reclaimable = 0;
+	for (int i = 0; i < entries.size(); i++)
+	{
+		if (i != keep && entries[i].last_used < frame)
+			reclaimable += entries[i].bytes;
+	}
+	if (bytes - reclaimable + size > budget)
+		return false;
+
+	// textures out of view for a while go first, then whatever was drawn least recently
+	while (bytes + size > budget)
+	{
+		int victim = getVictim(keep, false);
+		if (victim < 0)
+			victim = getVictim(keep, true);
+		if (victim < 0)
+			return false;
+
+		// halve before dropping entirely, a blurry body beats a grey one when it comes back into view
+		if ((entries[victim].width >> entries[victim].level) > min_width)
+			downsample(victim);
+		else
+			evict(victim);
+	}
+	return true;
+}
+
+void TextureManager::downsample(int id)
+{
+	PROFILE_SCOPE("TextureManager::downsample");
+
+	TextureEntry &entry = entries[id];
+	int width = std::max(entry.width >> entry.level, 1);
+	int height = std::max(entry.height >> entry.level, 1);
+	int levels = getLevelCount(width, height);
+
+	// the smaller mips are already on the gpu, copying them down avoids a decode and an upload
+	GLuint texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexStorage2D(GL_TEXTURE_2D, levels - 1, GL_RGB8, std::max(width / 2, 1), std::max(height / 2, 1));
+	for (int i = 1; i < levels; i++)
+		glCopyImageSubData(entry.texture, GL_TEXTURE_2D, i, 0, 0, 0, texture, GL_TEXTURE_2D, i - 1, 0, 0, 0, std::max(width >> i, 1), std::max(height >> i, 1), 1);
+
+	GLint min_filter;
+	GLint mag_filter;
+	glBindTexture(GL_TEXTURE_2D, entry.texture);
+	glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, &min_filter);
+	glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, &mag_filter);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, min_filter);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, mag_filter);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glDeleteTextures(1, &entry.texture);
+	bytes -= entry.bytes;
+
+	entry.texture = texture;
+	entry.level += 1;
+	entry.bytes = getTextureSize(std::max(width / 2, 1), std::max(height / 2, 1));
+	bytes += entry.bytes;
+}
+
+void TextureManager::evict(int id)
+{
+	TextureEntry &entry = entries[id];
+	if (!entry.texture)
+		return;
+
+	glDeleteTextures(1, &entry.texture);
+	bytes -= entry.bytes;
+	entry.texture = 0;
+	entry.bytes = 0;
+}
+
+int TextureManager::getVictim(int keep, bool visible)
+{
+	int victim = -1;
+	for (int i = 0; i < entries.size(); i++)
+	{
+		const TextureEntry &entry = entries[i];
+		if (i == keep || !entry.texture || entry.last_used >= frame)
+			continue;
+		if (!visible && entry.last_used + grace_frames > frame)
+			continue;
+		if (victim < 0 || entry.last_used < entries[victim].last_used)
+			victim = i;
+	}
+	return victim;
+}
+
+size_t TextureManager::getTextureSize(int width, int height)
+{
+	// drivers pad rgb8 to four bytes a texel, and the mip chain adds the rest
+	size_t size = 0;
+	for (int i = 0; i < getLevelCount(width, height); i++)
+		size += (size_t)std::max(width >> i, 1) * std::max(height >> i, 1) * 4;
+	return size;
+}
+
+int TextureManager::getLevelCount(int width, int height)
+{
+	return (int)std::floor(std::log2((float)std::max(width, height))) + 1;
+}
\ No newline at end of file
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <vector>
+#include <string>
+#include <mutex>
+#include <cstdint>
+#include <cstddef>
+
+struct TextureEntry
+{
+	std::string path = "";
+	GLuint texture = 0;
+
+	// size of the source image, the resident copy is that divided by 2^level
+	int width = 0;
+	int height = 0;
+	int level = 0;
+	size_t bytes = 0;
+
+	uint64_t last_used = 0;
+	uint64_t retry_frame = 0;
+	bool loading = false;
+	bool failed = false;
+};
+
+struct TextureLoad
+{
+	std::string path = "";
+	int id = 0;
+	int level = 0;
+	int width = 0;
+	int height = 0;
+	int source_width = 0;
+	int source_height = 0;
+	std::vector<unsigned char> pixels;
+};
+
+class TextureManager
+{
+public:
+	size_t budget = (size_t)512 * 1024 * 1024;
+
+	// frames a texture may go unseen before it is the first to give up memory
+	uint64_t grace_frames = 120;
+	int min_width = 64;
+
+	// decode on workers and draw a placeholder until the upload, off for captures that must match frame for frame
+	bool asynchronous = true;
+
+	std::vector<TextureEntry> entries;
+	size_t bytes = 0;
+	uint64_t frame = 0;
+	GLuint fallback = 0;
+
+	std::mutex mutex;
+	std::vector<TextureLoad *> finished;
+
+	void initialize();
+	int acquire(const std::string &path);
+	GLuint use(int id, float pixels);
+	void update();
+	void request(int id, int level);
+	void decode(TextureLoad *load);
+	void upload(TextureLoad *load);
+	void halve(TextureLoad *load);
+	bool makeRoom(size_t size, int keep);
+	void downsample(int id);
+	void evict(int id);
+	int getVictim(int keep, bool visible);
+	static size_t getTextureSize(int width, int height);
+	static int getLevelCount(int width, int height);
+};
@@ -0,0 +1,157 @@
+#include "trails.h"
+#include "global.h"
+#include "profiler.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <string>
+#include <fstream>
+#include <cstring>
+#include <cmath>
+
+void Trails::initialize(int body_count)
+{
+	PROFILE_SCOPE("Trails::initialize");
+
+	this->body_count = body_count;
+
+	// mapped once for the lifetime of the buffer, each new sample is a single row written straight into gpu memory
+	GLsizeiptr size = (GLsizeiptr)sample_count * body_count * sizeof(glm::vec4);
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+	glBufferStorage(GL_SHADER_STORAGE_BUFFER, size, nullptr, flags);
+	samples = (glm::vec4 *)glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, size, flags);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	// positions are pulled from the storage buffer by vertex id, the vao only exists because core profile needs one bound
+	glGenVertexArrays(1, &vao);
+
+	compileShader();
+	reset(simulation.current.time);
+}
+
+void Trails::compileShader()
+{
+	const char *vert_source;
+
+	std::ifstream vert_file(shader_path + ".vs");
+	std::string vert_string((std::istreambuf_iterator<char>(vert_file)), std::istreambuf_iterator<char>());
+	vert_source = vert_string.c_str();
+
+	unsigned int vert_shader;
+	vert_shader = glCreateShader(GL_VERTEX_SHADER);
+
+	glShaderSource(vert_shader, 1, &vert_source, NULL);
+	glCompileShader(vert_shader);
+
+	const char *frag_source;
+
+	std::ifstream frag_file(shader_path + ".fs");
+	std::string frag_string((std::istreambuf_iterator<char>(frag_file)), std::istreambuf_iterator<char>());
+	frag_source = frag_string.c_str();
+
+	unsigned int frag_shader;
+	frag_shader = glCreateShader(GL_FRAGMENT_SHADER);
+
+	glShaderSource(frag_shader, 1, &frag_source, NULL);
+	glCompileShader(frag_shader);
+
+	shader = glCreateProgram();
+
+	glAttachShader(shader, vert_shader);
+	glAttachShader(shader, frag_shader);
+	glLinkProgram(shader);
+
+	glDeleteShader(vert_shader);
+	glDeleteShader(frag_shader);
+}
+
+void Trails::reset(double time)
+{
+	if (!samples)
+		return;
+
+	// clearing touches every row, so nothing may still be reading any of them
+	for (int i = 0; i < latency; i++)
+		waitFence(i);
+
+	std::memset(samples, 0, (size_t)sample_count * body_count * sizeof(glm::vec4));
+	last_sample = time;
+	head = 0;
+}
+
+void Trails::update(double time)
+{
+	if (!samples)
+		return;
+
+	frame += 1;
+
+	// a seek or a rewind leaves the old trail describing a different history
+	if (std::abs(time - last_sample) > sample_interval * sample_count)
+		reset(time);
+
+	if (std::abs(time - last_sample) < sample_interval)
+		return;
+
+	PROFILE_SCOPE("Trails::update");
+
+	// the row about to be overwritten was last drawn latency frames ago, normally long finished
+	waitFence(frame % latency);
+
+	head = (head + 1) % sample_count;
+	glm::vec4 *row = samples + (size_t)head * body_count;
+	for (int i = 0; i < body_count; i++)
+	{
+		Planet *planet = solarsystem.planets[i];
+		row[i] = glm::vec4(planet->position, planet->lines_enabled && planet->visible ? 1.0f : 0.0f);
+	}
+	last_sample = time;
+}
+
+void Trails::draw()
+{
+	if (!enabled || !samples)
+		return;
+
+	PROFILE_SCOPE("Trails::draw");
+
+	int segment_count = sample_count - latency - 1;
+
+	glUseProgram(shader);
+	glUniformMatrix4fv(glGetUniformLocation(shader, "view"), 1, GL_FALSE, glm::value_ptr(camera.view));
+	glUniformMatrix4fv(glGetUniformLocation(shader, "projection"), 1, GL_FALSE, glm::value_ptr(camera.projection));
+	glUniform4fv(glGetUniformLocation(shader, "color"), 1, glm::value_ptr(color));
+	glUniform1i(glGetUniformLocation(shader, "body_count"), body_count);
+	glUniform1i(glGetUniformLocation(shader, "sample_count"), sample_count);
+	glUniform1i(glGetUniformLocation(shader, "segment_count"), segment_count);
+	glUniform1i(glGetUniformLocation(shader, "head"), head);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, buffer);
+	glBindVertexArray(vao);
+
+	glDrawArrays(GL_LINES, 0, body_count * segment_count * 2);
+	stats.countDraw(0);
+
+	glBindVertexArray(0);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+	glUseProgram(0);
+
+	int slot = frame % latency;
+	if (fences[slot])
+		glDeleteSync(fences[slot]);
+	fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void Trails::waitFence(int slot)
+{
+	if (!fences[slot])
+		return;
+
+	glClientWaitSync(fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+	glDeleteSync(fences[slot]);
+	fences[slot] = 0;
+}
\ No newline at end of file
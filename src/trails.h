@@ -0,0 +1,40 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <string>
+
+class Trails
+{
+public:
+	// frames a draw may still be reading the ring, the rows written during that time are kept out of the drawn span
+	static constexpr int latency = 3;
+
+	bool enabled = true;
+	int body_count = 0;
+	int sample_count = 256;
+
+	// simulated seconds between samples, so a trail always covers the same stretch of orbit
+	double sample_interval = 0.25;
+	double last_sample = 0.0;
+	int head = 0;
+	int frame = 0;
+
+	// one vec4 per body per sample, xyz position and w set once the sample holds a real position
+	GLuint buffer = 0;
+	glm::vec4 *samples = nullptr;
+	GLsync fences[latency] = {};
+
+	GLuint vao = 0;
+	GLuint shader = 0;
+	std::string shader_path = "res/shaders/planet_trail";
+	glm::vec4 color = glm::vec4(0.4f, 0.8f, 1.0f, 0.6f);
+
+	void initialize(int body_count);
+	void compileShader();
+	void reset(double time);
+	void update(double time);
+	void draw();
+	void waitFence(int slot);
+};
\ No newline at end of file
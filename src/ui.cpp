@@ -1,5 +1,7 @@
 #include "ui.h"
 #include "global.h"
+#include "profiler.h"
+#include "arena.h"
 
 #include <GLFW/glfw3.h>
 #include <glad/glad.h>
@@ -12,9 +14,12 @@
 #include <fstream>
 #include <iostream>
 #include <algorithm>
+#include <cmath>
 
 void Element::compileShader()
 {
+	PROFILE_SCOPE("Element::compileShader");
+
 	const char *vert_source;
 
 	std::ifstream vert_file(shader_path + ".vs");
@@ -80,6 +85,7 @@ void Element::draw()
 	glBindVertexArray(vao);
 
 	glDrawArrays(GL_TRIANGLES, 0, (GLsizei)mesh.size() / vert_stride);
+	stats.countDraw((int)mesh.size() / vert_stride / 3);
 
 	glBindVertexArray(0);
 	glUseProgram(0);
@@ -141,6 +147,8 @@ TexturedQuad::TexturedQuad()
 
 void TexturedQuad::loadTexture()
 {
+	PROFILE_SCOPE("TexturedQuad::loadTexture");
+
 	int width, height, channels;
 	unsigned char *data;
 
@@ -235,6 +243,7 @@ void TexturedQuad::draw()
 	glBindVertexArray(vao);
 
 	glDrawArrays(GL_TRIANGLES, 0, (GLsizei)mesh.size() / vert_stride);
+	stats.countDraw((int)mesh.size() / vert_stride / 3);
 
 	glBindVertexArray(0);
 	glBindTexture(GL_TEXTURE_2D, 0);
@@ -248,6 +257,8 @@ Label::Label()
 
 void Label::generateFont()
 {
+	PROFILE_SCOPE("Label::generateFont");
+
 	std::fstream file(font_path + ".csv", std::fstream::in);
 	std::string line;
 	std::vector<std::string> lines;
@@ -289,6 +300,8 @@ void Label::generateFont()
 
 void Label::loadTexture()
 {
+	PROFILE_SCOPE("Label::loadTexture");
+
 	generateFont();
 
 	int width, height, channels;
@@ -317,9 +330,19 @@ void Label::loadTexture()
 
 void Label::generateMesh()
 {
-	mesh = {};
+	mesh.clear();
+	appendText(text, position, color);
+}
+
+void Label::appendText(const std::string &text, glm::vec2 position, glm::vec4 color)
+{
 	glm::vec2 offset = glm::vec2(0.0f);
 
+	if (parent)
+	{
+		position += parent->position;
+	}
+
 	for (int i = 0; i < text.length(); i++)
 	{
 		int c = (int)(char)text[i];
@@ -335,31 +358,32 @@ void Label::generateMesh()
 		glm::vec2 tex_position = glyph.tex_position;
 		glm::vec2 tex_size = glyph.tex_size;
 
-		glm::vec2 position = this->position;
-
-		if (parent)
-		{
-			position += parent->position;
-		}
-
-		position += offset * scale;
+		glm::vec2 glyph_position = position + offset * scale;
 
 		vert_stride = 8;
-		std::vector<float> verts = {
-			position.x,			 position.y,		  color.r, color.g, color.b, color.a, tex_position.x,			   tex_position.y + tex_size.y,
-			position.x,			 position.y + size.y, color.r, color.g, color.b, color.a, tex_position.x,			   tex_position.y,
-			position.x + size.x, position.y,		  color.r, color.g, color.b, color.a, tex_position.x + tex_size.x, tex_position.y + tex_size.y,
-
-			position.x + size.x, position.y,		  color.r, color.g, color.b, color.a, tex_position.x + tex_size.x, tex_position.y + tex_size.y,
-			position.x,			 position.y + size.y, color.r, color.g, color.b, color.a, tex_position.x,			   tex_position.y,
-			position.x + size.x, position.y + size.y, color.r, color.g, color.b, color.a, tex_position.x + tex_size.x, tex_position.y
+		const float verts[] = {
+			glyph_position.x,			glyph_position.y,			color.r, color.g, color.b, color.a, tex_position.x,				tex_position.y + tex_size.y,
+			glyph_position.x,			glyph_position.y + size.y,	color.r, color.g, color.b, color.a, tex_position.x,				tex_position.y,
+			glyph_position.x + size.x,	glyph_position.y,			color.r, color.g, color.b, color.a, tex_position.x + tex_size.x,	tex_position.y + tex_size.y,
+
+			glyph_position.x + size.x,	glyph_position.y,			color.r, color.g, color.b, color.a, tex_position.x + tex_size.x,	tex_position.y + tex_size.y,
+			glyph_position.x,			glyph_position.y + size.y,	color.r, color.g, color.b, color.a, tex_position.x,				tex_position.y,
+			glyph_position.x + size.x,	glyph_position.y + size.y,	color.r, color.g, color.b, color.a, tex_position.x + tex_size.x,	tex_position.y
 		};
-		mesh.insert(mesh.end(), verts.begin(), verts.end());
+		mesh.insert(mesh.end(), std::begin(verts), std::end(verts));
 
 		offset.x += glyph.width;
 	}
 }
 
+float Label::getTextWidth(const std::string &text)
+{
+	float width = 0.0f;
+	for (int i = 0; i < text.length(); i++)
+		width += glyphs[(int)(char)text[i]].width;
+	return width * scale.x;
+}
+
 void Label::updateBuffers()
 {
 	glBindVertexArray(vao);
@@ -405,35 +429,124 @@ void Label::draw()
 	glBindVertexArray(vao);
 
 	glDrawArrays(GL_TRIANGLES, 0, (GLsizei)mesh.size() / vert_stride);
+	stats.countDraw((int)mesh.size() / vert_stride / 3);
 
 	glBindVertexArray(0);
 	glBindTexture(GL_TEXTURE_2D, 0);
 	glUseProgram(0);
 }
 
+void TagLayer::updateTags()
+{
+	PROFILE_SCOPE("TagLayer::updateTags");
+
+	candidates.clear();
+	tags.clear();
+	if (!ui.enabled)
+		return;
+
+	glm::mat4 view_projection = camera.projection * camera.view;
+	float focal_length = camera.projection[1][1] * camera.resolution.y * 0.5f;
+
+	for (int i = 0; i < solarsystem.planets.size(); i++)
+	{
+		Planet *planet = solarsystem.planets[i];
+		if (!planet->visible || planet == camera.anchor)
+			continue;
+
+		glm::vec4 clip_pos = view_projection * glm::vec4(planet->position, 1.0f);
+		if (clip_pos.w <= 0.0f)
+			continue;
+
+		glm::vec2 screen_pos = glm::vec2(clip_pos) / clip_pos.w;
+		if (std::abs(screen_pos.x) > 1.0f || std::abs(screen_pos.y) > 1.0f)
+			continue;
+
+		int depth = 0;
+		for (Planet *anchor = planet->orbit_anchor; anchor; anchor = anchor->orbit_anchor)
+			depth += 1;
+
+		// big on screen and high in the hierarchy wins, so a moon only gets a tag once there is room next to its planet
+		float apparent_radius = planet->radius * focal_length / clip_pos.w;
+		glm::vec2 window_pos = ((screen_pos + glm::vec2(1.0f)) / 2.0f) * glm::vec2(camera.resolution.x, -camera.resolution.y) + glm::vec2(0.0f, camera.resolution.y);
+
+		Tag tag;
+		tag.planet = planet;
+		tag.priority = apparent_radius / (1.0f + depth);
+		tag.position = window_pos + glm::vec2(apparent_radius + 4.0f, -scale.y * 0.5f);
+		candidates.push_back(tag);
+	}
+
+	// only the best few are worth placing, anything further down would almost never find free space
+	int considered = std::min((int)candidates.size(), max_tags * 4);
+	std::partial_sort(candidates.begin(), candidates.begin() + considered, candidates.end(), [](const Tag &a, const Tag &b)
+	{
+		return a.priority > b.priority;
+	});
+
+	glm::ivec2 grid = glm::ivec2(glm::ceil(camera.resolution / cell_size));
+	occupied.assign(grid.x * grid.y, 0);
+
+	for (int i = 0; i < considered && tags.size() < max_tags; i++)
+	{
+		Tag &tag = candidates[i];
+		tag.size = glm::vec2(getTextWidth(tag.planet->name), scale.y);
+		if (placeTag(tag, grid))
+			tags.push_back(tag);
+	}
+}
+
+bool TagLayer::placeTag(const Tag &tag, glm::ivec2 grid)
+{
+	glm::ivec2 first = glm::clamp(glm::ivec2(glm::floor(tag.position / cell_size)), glm::ivec2(0), grid - 1);
+	glm::ivec2 last = glm::clamp(glm::ivec2(glm::floor((tag.position + tag.size) / cell_size)), glm::ivec2(0), grid - 1);
+
+	for (int y = first.y; y <= last.y; y++)
+		for (int x = first.x; x <= last.x; x++)
+			if (occupied[y * grid.x + x])
+				return false;
+
+	for (int y = first.y; y <= last.y; y++)
+		for (int x = first.x; x <= last.x; x++)
+			occupied[y * grid.x + x] = 1;
+	return true;
+}
+
+void TagLayer::generateMesh()
+{
+	mesh.clear();
+	for (int i = 0; i < tags.size(); i++)
+		appendText(tags[i].planet->name, tags[i].position, color);
+}
+
 void Page::updateElements()
 {
-	float time = (float)glfwGetTime();
 	glm::dvec2 cursor = glm::vec2(0.0f, 0.0f);
 
-	if (cursor_enabled)
+	if (ui.window && cursor_enabled)
 	{
 		glfwSetInputMode(ui.window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
 		glfwGetCursorPos(ui.window, &(cursor.x), &(cursor.y));
 	}
-	else
+	else if (ui.window)
 	{
 		glfwSetInputMode(ui.window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 	}
 
 	Label *info_label = (Label *)ui.pages[0]->elements[0];
 	info_label->color = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f * ui.enabled);
-	info_label->text = "salat\n";
-	info_label->text += "timescale: " + std::to_string(solarsystem.time_scale * !solarsystem.paused) + "\n";
-	info_label->text += "movespeed: " + std::to_string(camera.speed) + "\n";
-	info_label->text += "position: " + std::to_string(camera.position.x) + ", " + std::to_string(camera.position.y) + ", " + std::to_string(camera.position.z) + "\n";
-	info_label->text += "offset: " + std::to_string(camera.offset.x) + ", " + std::to_string(camera.offset.y) + ", " + std::to_string(camera.offset.z) + "\n";
-	info_label->text += "anchor: " + camera.anchor->name + "\n";
+	FrameString text;
+	text += "salat\n";
+	appendFormat(text, "timescale: %f\n", solarsystem.time_scale * !solarsystem.paused);
+	appendFormat(text, "movespeed: %f\n", camera.speed);
+	appendFormat(text, "position: %f, %f, %f\n", camera.position.x, camera.position.y, camera.position.z);
+	appendFormat(text, "offset: %f, %f, %f\n", camera.offset.x, camera.offset.y, camera.offset.z);
+	appendFormat(text, "anchor: %s\n", camera.anchor->name.c_str());
+	appendFormat(text, "time: %f s, checkpoints: %d\n", simulation.current.time, simulation.checkpoint_count.load());
+	appendFormat(text, "pacing: %s, fps: %f\n", pacer.getModeName().c_str(), pacer.delta_time > 0.0f ? 1.0f / pacer.delta_time : 0.0f);
+	appendFormat(text, "gpu: %f ms\n", gpu_timer.frame_time);
+	appendFormat(text, "jitter: %f ms, max: %f ms\n", pacer.jitter * 1000.0f, pacer.max_jitter * 1000.0f);
+	info_label->text.assign(text.data(), text.size());
 
 	glm::vec4 planet_world_pos = glm::vec4(camera.anchor->position, 1.0f);
 	glm::vec4 planet_clip_pos = camera.projection * (camera.view * planet_world_pos);
@@ -441,29 +554,96 @@ void Page::updateElements()
 	if (planet_clip_pos.w > 0.0f)
 	{
 		glm::vec2 planet_screen_pos = glm::vec3(planet_clip_pos) / planet_clip_pos.w;
-		planet_window_pos = ((planet_screen_pos + glm::vec2(1.0f)) / 2.0f) * glm::vec2(1920.0f, -1080.0f) + glm::vec2(0.0f, 1080.0f);
+		planet_window_pos = ((planet_screen_pos + glm::vec2(1.0f)) / 2.0f) * glm::vec2(camera.resolution.x, -camera.resolution.y) + glm::vec2(0.0f, camera.resolution.y);
 	}
 
 	Label *planet_label = (Label *)ui.pages[0]->elements[1];
 	planet_label->color = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f * ui.enabled);
 	planet_label->position = planet_window_pos + glm::vec2(0.0f, 0.0f);
-	planet_label->text = "";
-	planet_label->text += "name: " + camera.anchor->name + "\n";
-	planet_label->text += "id: " + std::to_string(camera.anchor->id) + "\n";
-	planet_label->text += "mass: " + std::to_string(camera.anchor->mass) + "\n";
-	planet_label->text += "radius: " + std::to_string(camera.anchor->radius) + "\n";
-	planet_label->text += "orbit radius: " + std::to_string(camera.anchor->orbit_radius) + "\n";
-	if (camera.anchor->orbit_anchor)
-		planet_label->text += "orbit anchor: " + camera.anchor->orbit_anchor->name + "\n";
+	Planet *anchor = camera.anchor;
+	text.clear();
+	appendFormat(text, "name: %s\n", anchor->name.c_str());
+	appendFormat(text, "id: %d\n", anchor->id);
+	appendFormat(text, "mass: %f\n", anchor->mass);
+	appendFormat(text, "radius: %f\n", anchor->radius);
+	appendFormat(text, "orbit radius: %f\n", anchor->orbit_radius);
+	if (anchor->orbit_anchor)
+		appendFormat(text, "orbit anchor: %s\n", anchor->orbit_anchor->name.c_str());
 	else
-		planet_label->text += "orbit center: " + std::to_string(camera.anchor->orbit_center.x) + ", " + std::to_string(camera.anchor->orbit_center.y) + ", " + std::to_string(camera.anchor->orbit_center.z) + "\n";
-	planet_label->text += "orbit speed: " + std::to_string(camera.anchor->orbit_speed) + "\n";
-	planet_label->text += "orbit offset: " + std::to_string(camera.anchor->orbit_offset) + "\n";
-	planet_label->text += "orbit axis: " + std::to_string(camera.anchor->orbit_axis.x) + ", " + std::to_string(camera.anchor->orbit_axis.y) + ", " + std::to_string(camera.anchor->orbit_axis.z) + "\n";
-	planet_label->text += "rotation speed: " + std::to_string(camera.anchor->rotation_speed) + "\n";
-	planet_label->text += "rotation offset: " + std::to_string(camera.anchor->rotation_offset) + "\n";
-	planet_label->text += "rotation axis: " + std::to_string(camera.anchor->rotation_axis.x) + ", " + std::to_string(camera.anchor->rotation_axis.y) + ", " + std::to_string(camera.anchor->rotation_axis.z) + "\n";
-	planet_label->text += "pole axis: " + std::to_string(camera.anchor->pole_axis.x) + ", " + std::to_string(camera.anchor->pole_axis.y) + ", " + std::to_string(camera.anchor->pole_axis.z) + "\n";
+		appendFormat(text, "orbit center: %f, %f, %f\n", anchor->orbit_center.x, anchor->orbit_center.y, anchor->orbit_center.z);
+	appendFormat(text, "orbit speed: %f\n", anchor->orbit_speed);
+	appendFormat(text, "orbit offset: %f\n", anchor->orbit_offset);
+	appendFormat(text, "orbit axis: %f, %f, %f\n", anchor->orbit_axis.x, anchor->orbit_axis.y, anchor->orbit_axis.z);
+	appendFormat(text, "rotation speed: %f\n", anchor->rotation_speed);
+	appendFormat(text, "rotation offset: %f\n", anchor->rotation_offset);
+	appendFormat(text, "rotation axis: %f, %f, %f\n", anchor->rotation_axis.x, anchor->rotation_axis.y, anchor->rotation_axis.z);
+	appendFormat(text, "pole axis: %f, %f, %f\n", anchor->pole_axis.x, anchor->pole_axis.y, anchor->pole_axis.z);
+	planet_label->text.assign(text.data(), text.size());
+
+	if (id == 0)
+	{
+		TagLayer *tag_layer = (TagLayer *)ui.pages[0]->elements[2];
+		tag_layer->color = glm::vec4(0.8f, 0.9f, 1.0f, 0.8f);
+		tag_layer->updateTags();
+	}
+
+	if (id == 2)
+		updatePerformanceElements();
+}
+
+void Page::updatePerformanceElements()
+{
+	stats.updatePercentiles();
+
+	glm::vec2 graph_position = glm::vec2(10.0f, 10.0f);
+	glm::vec2 graph_size = glm::vec2(640.0f, 200.0f);
+	float bar_width = graph_size.x / Stats::bins;
+
+	Quad *background = (Quad *)elements[0];
+	background->position = graph_position;
+	background->size = graph_size;
+	background->color = glm::vec4(0.0f, 0.0f, 0.0f, 0.5f * ui.enabled);
+
+	for (int i = 0; i < Stats::bins; i++)
+	{
+		float height = graph_size.y * (float)stats.histogram[i] / (float)std::max(stats.histogram_peak, 1);
+		float bin_time = stats.histogram_range * (i + 0.5f) / Stats::bins;
+
+		Quad *bar = (Quad *)elements[1 + i];
+		bar->position = graph_position + glm::vec2(i * bar_width, graph_size.y - height);
+		bar->size = glm::vec2(bar_width - 1.0f, height);
+		if (bin_time > stats.p99)
+			bar->color = glm::vec4(1.0f, 0.3f, 0.2f, 0.9f * ui.enabled);
+		else if (bin_time > stats.p95)
+			bar->color = glm::vec4(1.0f, 0.8f, 0.2f, 0.9f * ui.enabled);
+		else
+			bar->color = glm::vec4(0.3f, 1.0f, 0.4f, 0.9f * ui.enabled);
+	}
+
+	Label *stats_label = (Label *)elements[1 + Stats::bins];
+	stats_label->color = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f * ui.enabled);
+	stats_label->position = graph_position + glm::vec2(0.0f, graph_size.y + 10.0f);
+	FrameString text;
+	text += "performance\n";
+	appendFormat(text, "histogram: 0 - %f ms\n", stats.histogram_range);
+	appendFormat(text, "p50: %f ms, p95: %f ms\n", stats.p50, stats.p95);
+	appendFormat(text, "p99: %f ms, max: %f ms\n", stats.p99, stats.max);
+	for (int i = 0; i < Stats::section_count; i++)
+		appendFormat(text, "%s: %f ms\n", stats.getSectionName((Section)i), stats.section_times[i]);
+	appendFormat(text, "simulation step: %f ms\n", simulation.step_time.load());
+	for (int i = 0; i < GpuTimer::pass_count; i++)
+		appendFormat(text, "gpu %s: %f ms\n", gpu_timer.getPassName((GpuPass)i), gpu_timer.pass_times[i]);
+	appendFormat(text, "bodies: %d\n", stats.bodies);
+	appendFormat(text, "textures: %d / %d MB\n", (int)(textures.bytes / (1024 * 1024)), (int)(textures.budget / (1024 * 1024)));
+	appendFormat(text, "stars: %d / %d\n", stars.drawn, (int)stars.magnitudes.size());
+	appendFormat(text, "terrain: %d / %d chunks, %d queued\n", terrain.drawn_chunks, terrain.chunk_count, terrain.queued.load());
+	appendFormat(text, "contacts: %d\n", simulation.collisions.contact_count.load());
+	appendFormat(text, "gravity: level %d, %d forces\n", simulation.gravity.deepest_level.load(), simulation.gravity.force_count.load());
+	appendFormat(text, "draw calls: %d\n", stats.draw_calls);
+	appendFormat(text, "triangles: %d\n", stats.triangles);
+	appendFormat(text, "allocations: %llu, all threads: %llu\n", (unsigned long long)stats.allocations, (unsigned long long)stats.process_allocations);
+	appendFormat(text, "frame arena: %d KB\n", (int)(frameArena().getUsed() / 1024));
+	stats_label->text.assign(text.data(), text.size());
 }
 
 void Page::generateElements()
@@ -486,7 +666,7 @@ void Page::drawElements()
 
 void UI::initializePages()
 {
-	for (int i = 0; i < 2; i++)
+	for (int i = 0; i < 3; i++)
 	{
 		Page *page = new Page;
 		page->id = i;
@@ -507,14 +687,33 @@ void UI::initializePages()
 	planet_label->text = "";
 	pages[0]->elements.push_back(planet_label);
 
+	TagLayer *tag_layer = new TagLayer;
+	tag_layer->scale = glm::vec2(16.0f);
+	pages[0]->elements.push_back(tag_layer);
+
 	Label *menu_label = new Label;
 	menu_label->position = glm::vec2(10.0f, 10.0f);
 	menu_label->scale = glm::vec2(24.0f);
 	menu_label->color = glm::vec4(1.0f);
-	menu_label->text = "keybinds\nWASD: movement\nUP/DOWN: camera speed\nLEFT/RIGHT: timescale\nSHFIT: sprint\nSPACE: pause\nQ: toggle ui\nTAB: toggle wireframe\n1-9: change anchor\nENTER: menu\nESCAPE: exit";
+	menu_label->text = "keybinds\nWASD: movement\nUP/DOWN: camera speed\nLEFT/RIGHT: timescale\nSHFIT: sprint\nSPACE: pause\nQ: toggle ui\nP: write trace\nTAB: toggle wireframe\nT: toggle trails\nG: toggle gravity\nF5/F9: save/load snapshot\nV: frame pacing\n[/]: seek 10s\n0-9: change anchor\nSCROLL: zoom\nCLICK: select body\nENTER: menu\nESCAPE: exit";
 	pages[1]->elements.push_back(menu_label);
 	pages[1]->cursor_enabled = true;
 
+	Quad *graph_background = new Quad;
+	pages[2]->elements.push_back(graph_background);
+
+	for (int i = 0; i < Stats::bins; i++)
+	{
+		Quad *graph_bar = new Quad;
+		pages[2]->elements.push_back(graph_bar);
+	}
+
+	Label *stats_label = new Label;
+	stats_label->scale = glm::vec2(24.0f);
+	stats_label->color = glm::vec4(1.0f);
+	stats_label->text = "";
+	pages[2]->elements.push_back(stats_label);
+
 	for (int i = 0; i < pages.size(); i++)
 		for (int j = 0; j < pages[i]->elements.size(); j++)
 		{
@@ -524,13 +723,22 @@ void UI::initializePages()
 		}
 }
 
+void UI::updateProjection()
+{
+	projection = glm::ortho(0.0f, camera.resolution.x, camera.resolution.y, 0.0f, -1.0f, 1.0f);
+}
+
 void UI::updatePage(Page *page)
 {
+	PROFILE_SCOPE("UI::updatePage");
+
 	page->updateElements();
 	page->generateElements();
 }
 
 void UI::drawPage(Page *page)
 {
+	PROFILE_SCOPE("UI::drawPage");
+
 	page->drawElements();
 }
\ No newline at end of file
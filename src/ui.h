@@ -9,6 +9,8 @@
 #include <string>
 #include <map>
 
+class Planet;
+
 class Element
 {
 public:
@@ -93,11 +95,38 @@ public:
 	void loadTexture();
 
 	void generateMesh();
+	void appendText(const std::string &text, glm::vec2 position, glm::vec4 color);
+	float getTextWidth(const std::string &text);
 	void updateBuffers();
 	void setUniforms();
 	void draw();
 };
 
+struct Tag
+{
+	glm::vec2 position = glm::vec2(0.0f);
+	glm::vec2 size = glm::vec2(0.0f);
+	float priority = 0.0f;
+	Planet *planet = nullptr;
+};
+
+// name tags for every body in one mesh and one draw, thinned out wherever they would overlap
+class TagLayer : public Label
+{
+public:
+	// the screen is split into cells this many pixels wide, a tag is only placed where all its cells are still free
+	float cell_size = 16.0f;
+	int max_tags = 256;
+
+	std::vector<Tag> candidates;
+	std::vector<Tag> tags;
+	std::vector<unsigned char> occupied;
+
+	void updateTags();
+	bool placeTag(const Tag &tag, glm::ivec2 grid);
+	void generateMesh();
+};
+
 class Page
 {
 public:
@@ -107,6 +136,7 @@ public:
 	int id = 0;
 
 	void updateElements();
+	void updatePerformanceElements();
 	void generateElements();
 	void drawElements();
 };
@@ -123,6 +153,7 @@ public:
 	GLFWwindow* window;
 
 	void initializePages();
+	void updateProjection();
 	void updatePage(Page* page);
 	void drawPage(Page* page);
 };
\ No newline at end of file
@@ -0,0 +1,75 @@
+#!/usr/bin/env python3
+# converts a HYG database csv (https://github.com/astronexus/HYG-Database) into the binary catalog helios maps at startup
+#
+#   python3 tools/make_star_catalog.py hygdata_v3.csv res/stars/catalog.hstr [--limit 12.0]
+#
+# layout matches StarCatalogHeader and StarEntry in src/stars.h, entries sorted brightest first
+
+import argparse
+import csv
+import math
+import struct
+
+HEADER = struct.Struct("<4sIIIQ")
+ENTRY = struct.Struct("<3ff4B")
+VERSION = 1
+
+
+def temperature(color_index):
+    # ballesteros' formula, b-v colour index to effective temperature
+    return 4600.0 * (1.0 / (0.92 * color_index + 1.7) + 1.0 / (0.92 * color_index + 0.62))
+
+
+def blackbody(kelvin):
+    # tanner helland's fit of blackbody colour, good enough for point sprites
+    t = kelvin / 100.0
+    if t <= 66.0:
+        r = 255.0
+        g = 99.4708025861 * math.log(t) - 161.1195681661
+        b = 0.0 if t <= 19.0 else 138.5177312231 * math.log(t - 10.0) - 305.0447927307
+    else:
+        r = 329.698727446 * math.pow(t - 60.0, -0.1332047592)
+        g = 288.1221695283 * math.pow(t - 60.0, -0.0755148492)
+        b = 255.0
+    return tuple(int(min(max(c, 0.0), 255.0)) for c in (r, g, b))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="convert a HYG csv into a helios star catalog")
+    parser.add_argument("input")
+    parser.add_argument("output")
+    parser.add_argument("--limit", type=float, default=99.0, help="drop stars fainter than this apparent magnitude")
+    args = parser.parse_args()
+
+    stars = []
+    with open(args.input, newline="") as file:
+        for row in csv.DictReader(file):
+            try:
+                x, y, z = float(row["x"]), float(row["y"]), float(row["z"])
+                magnitude = float(row["mag"])
+            except (KeyError, ValueError):
+                continue
+
+            # the sun sits at the origin of the catalog and has no direction
+            length = math.sqrt(x * x + y * y + z * z)
+            if length == 0.0 or magnitude > args.limit:
+                continue
+
+            try:
+                color = blackbody(temperature(float(row["ci"])))
+            except (KeyError, ValueError, ZeroDivisionError):
+                color = (255, 255, 255)
+            stars.append((magnitude, x / length, y / length, z / length, color))
+
+    stars.sort(key=lambda star: star[0])
+
+    with open(args.output, "wb") as file:
+        file.write(HEADER.pack(b"HSTR", VERSION, HEADER.size, ENTRY.size, len(stars)))
+        for magnitude, x, y, z, color in stars:
+            file.write(ENTRY.pack(x, y, z, magnitude, color[0], color[1], color[2], 255))
+
+    print("wrote %d stars to %s" % (len(stars), args.output))
+
+
+if __name__ == "__main__":
+    main()